@@ -21,6 +21,7 @@
 #include <iostream>
 #include <stdlib.h>
 #include <string>
+#include <cstring>
 #include <utility>
 #include <memory>
 #include <algorithm>
@@ -126,6 +127,10 @@ apex::~apex()
     //cout << "Getting energy..." << endl;
     energyDaemonTerm();
 #endif
+    for (auto list : subscriber_lists) {
+        delete list;
+    }
+    subscriber_lists.clear();
     for (unsigned int i = listeners.size(); i > 0 ; i--) {
         event_listener * el = listeners[i-1];
         listeners.pop_back();
@@ -311,6 +316,7 @@ void apex::_initialize()
             this->m_policy_handler = new policy_handler();
             listeners.push_back(this->m_policy_handler);
         }
+        update_subscribers();
     }
     this->resize_state(1);
     this->set_state(0, APEX_BUSY);
@@ -355,15 +361,34 @@ policy_handler * apex::get_policy_handler(void) const
 
 policy_handler * apex::get_policy_handler(uint64_t const& period)
 {
+    write_lock_type l(listener_mutex);
     if(apex_options::use_policy() && period_handlers.count(period) == 0)
     {
         period_handlers[period] = new policy_handler(period);
-        //write_lock_type l(listener_mutex);
         listeners.push_back(period_handlers[period]);
+        update_subscribers();
     }
     return period_handlers[period];
 }
 
+/* Rebuild the per-event lists of listeners.  Called whenever a listener
+ * is added, with listener_mutex held (or before the instance is visible).
+ * Each new list is built off to the side and then published; the list it
+ * replaces may still be in use by another thread, so it isn't freed. */
+void apex::update_subscribers(void)
+{
+    for (unsigned int e = 0 ; e < listen_event_count ; e++) {
+        subscriber_list * tmp = new subscriber_list();
+        for (auto el : listeners) {
+            if (el->subscriptions() & listen_mask((listener_event)e)) {
+                tmp->push_back(el);
+            }
+        }
+        subscriber_lists.push_back(tmp);
+        subscribers[e].store(tmp, std::memory_order_release);
+    }
+}
+
 #ifdef APEX_HAVE_HPX
 void apex::set_hpx_runtime(hpx::runtime * hpx_runtime) {
     m_hpx_runtime = hpx_runtime;
@@ -405,6 +430,8 @@ uint64_t init(const char * thread_name, uint64_t comm_rank,
     std::atexit(cleanup);
     //thread_instance::set_worker(true);
     _registered = true;
+    /* choose the timestamp source before any timers are started */
+    apex_clock::calibrate(apex_options::timer_clock());
     apex* instance = apex::instance(); // get/create the Apex static instance
     // assign the rank and size.  Why not in the constructor?
     // because, if we registered a startup policy, the default
@@ -500,7 +527,8 @@ inline std::shared_ptr<task_wrapper> _new_task(
     const uint64_t task_id,
     const std::shared_ptr<task_wrapper> parent_task, apex* instance) {
     APEX_UNUSED(instance);
-    std::shared_ptr<task_wrapper> tt_ptr = make_shared<task_wrapper>();
+    std::shared_ptr<task_wrapper> tt_ptr =
+        std::allocate_shared<task_wrapper>(pool_allocator<task_wrapper>());
     tt_ptr->task_id = id;
     // if not tracking dependencies, don't save the parent
     /* Why?
@@ -553,7 +581,8 @@ profiler* start(const std::string &timer_name)
         return profiler::get_disabled_profiler();
     }
     // don't time filtered events
-    if (event_filter::instance().have_filter && event_filter::exclude(timer_name)) {
+    if (event_filter::instance().have_filter &&
+        event_filter::exclude(task_identifier::get_task_id(timer_name))) {
         return profiler::get_disabled_profiler();
     }
     apex* instance = apex::instance(); // get the Apex static instance
@@ -577,8 +606,9 @@ profiler* start(const std::string &timer_name)
         //read_lock_type l(instance->listener_mutex);
         //cout << thread_instance::get_id() << " Start : " << id->get_name() <<
         //endl; fflush(stdout);
-        for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-            success = instance->listeners[i]->on_start(tt_ptr);
+        auto& subs = instance->get_subscribers(listen_start);
+        for (unsigned int i = 0 ; i < subs.size() ; i++) {
+            success = subs[i]->on_start(tt_ptr);
             if (!success && i == 0) {
                 //cout << thread_instance::get_id() << " *** Not success! " <<
                 //id->get_name() << endl; fflush(stdout);
@@ -604,6 +634,22 @@ profiler* start(const std::string &timer_name)
     return thread_instance::instance().restore_children_profilers(tt_ptr);
 }
 
+profiler* start(const char * timer_name)
+{
+    in_apex prevent_deadlocks;
+    // if APEX is disabled, do nothing.
+    if (apex_options::disable() == true) {
+        APEX_UTIL_REF_COUNT_DISABLED_START
+        return nullptr;
+    }
+    if (strncmp(timer_name, "apex_internal", 13) == 0) {
+        APEX_UTIL_REF_COUNT_APEX_INTERNAL_START
+        // don't process our own events - queue scrubbing tasks.
+        return profiler::get_disabled_profiler();
+    }
+    return start(task_identifier::get_task_id(timer_name));
+}
+
 profiler* start(const apex_function_address function_address) {
     in_apex prevent_deadlocks;
     // if APEX is disabled, do nothing.
@@ -632,8 +678,9 @@ profiler* start(const apex_function_address function_address) {
         //cout << thread_instance::get_id() << " Start : " << id->get_name() <<
         //endl; fflush(stdout);
         //read_lock_type l(instance->listener_mutex);
-        for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-            success = instance->listeners[i]->on_start(tt_ptr);
+        auto& subs = instance->get_subscribers(listen_start);
+        for (unsigned int i = 0 ; i < subs.size() ; i++) {
+            success = subs[i]->on_start(tt_ptr);
             if (!success && i == 0) {
                 //cout << thread_instance::get_id() << " *** Not success! " <<
                 //id->get_name() << endl; fflush(stdout);
@@ -654,6 +701,60 @@ profiler* start(const apex_function_address function_address) {
     return thread_instance::instance().restore_children_profilers(tt_ptr);
 }
 
+profiler* start(task_identifier * id) {
+    in_apex prevent_deadlocks;
+    // if APEX is disabled, do nothing.
+    if (apex_options::disable() == true) {
+        APEX_UTIL_REF_COUNT_DISABLED_START
+        return nullptr;
+    }
+    if (id == nullptr) {
+        APEX_UTIL_REF_COUNT_FAILED_START
+        return profiler::get_disabled_profiler();
+    }
+    // don't time filtered events
+    if (event_filter::instance().have_filter && id->has_name &&
+        event_filter::exclude(id)) {
+        return profiler::get_disabled_profiler();
+    }
+    apex* instance = apex::instance(); // get the Apex static instance
+    // protect against calls after finalization
+    if (!instance || _exited) {
+        APEX_UTIL_REF_COUNT_START_AFTER_FINALIZE
+        return nullptr;
+    }
+    // if APEX is suspended, do nothing.
+    if (apex_options::suspend() == true) {
+        APEX_UTIL_REF_COUNT_SUSPENDED_START
+        return profiler::get_disabled_profiler();
+    }
+    std::shared_ptr<task_wrapper> tt_ptr(nullptr);
+    profiler * new_profiler = nullptr;
+    if (_notify_listeners) {
+        bool success = true;
+        tt_ptr = _new_task(id, UINTMAX_MAX, null_task_wrapper, instance);
+        APEX_UTIL_REF_COUNT_TASK_WRAPPER
+        auto& subs = instance->get_subscribers(listen_start);
+        for (unsigned int i = 0 ; i < subs.size() ; i++) {
+            success = subs[i]->on_start(tt_ptr);
+            if (!success && i == 0) {
+                APEX_UTIL_REF_COUNT_FAILED_START
+                return profiler::get_disabled_profiler();
+            }
+        }
+        // If we are allowing untied timers, clear the timer stack on this thread
+        if (apex_options::untied_timers() == true) {
+            new_profiler = thread_instance::instance().get_current_profiler();
+            thread_instance::instance().clear_current_profiler();
+        }
+    }
+    APEX_UTIL_REF_COUNT_START
+    if (apex_options::untied_timers() == true) {
+        return new_profiler;
+    }
+    return thread_instance::instance().restore_children_profilers(tt_ptr);
+}
+
 void debug_print(const char * event, std::shared_ptr<task_wrapper> tt_ptr) {
     if (_program_over) return;
     static std::mutex this_mutex;
@@ -686,7 +787,7 @@ void start(std::shared_ptr<task_wrapper> tt_ptr) {
         return;
     }
     // don't time filtered events
-    if (event_filter::instance().have_filter && event_filter::exclude(tt_ptr->task_id->get_name())) {
+    if (event_filter::instance().have_filter && event_filter::exclude(tt_ptr->task_id)) {
         tt_ptr->prof = nullptr;
         return;
     }
@@ -708,8 +809,9 @@ void start(std::shared_ptr<task_wrapper> tt_ptr) {
         //cout << thread_instance::get_id() << " Start : " <<tt_ptr->task_id->get_name() <<
         //endl; fflush(stdout);
         //read_lock_type l(instance->listener_mutex);
-        for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-            success = instance->listeners[i]->on_start(tt_ptr);
+        auto& subs = instance->get_subscribers(listen_start);
+        for (unsigned int i = 0 ; i < subs.size() ; i++) {
+            success = subs[i]->on_start(tt_ptr);
             tt_ptr->prof = thread_instance::instance().get_current_profiler();
             if (!success && i == 0) {
                 //cout << thread_instance::get_id() << " *** Not success! " <<
@@ -747,7 +849,8 @@ profiler* resume(const std::string &timer_name) {
         return profiler::get_disabled_profiler();
     }
     // don't time filtered events
-    if (event_filter::instance().have_filter && event_filter::exclude(timer_name)) {
+    if (event_filter::instance().have_filter &&
+        event_filter::exclude(task_identifier::get_task_id(timer_name))) {
         return profiler::get_disabled_profiler();
     }
     apex* instance = apex::instance(); // get the Apex static instance
@@ -763,8 +866,9 @@ profiler* resume(const std::string &timer_name) {
         APEX_UTIL_REF_COUNT_TASK_WRAPPER
         try {
             //read_lock_type l(instance->listener_mutex);
-            for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-                instance->listeners[i]->on_resume(tt_ptr);
+            auto& subs = instance->get_subscribers(listen_resume);
+            for (unsigned int i = 0 ; i < subs.size() ; i++) {
+                subs[i]->on_resume(tt_ptr);
             }
         } catch (disabled_profiler_exception &e) {
             APEX_UTIL_REF_COUNT_FAILED_RESUME
@@ -805,8 +909,9 @@ profiler* resume(const apex_function_address function_address) {
         APEX_UTIL_REF_COUNT_TASK_WRAPPER
         try {
             //read_lock_type l(instance->listener_mutex);
-            for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-                instance->listeners[i]->on_resume(tt_ptr);
+            auto& subs = instance->get_subscribers(listen_resume);
+            for (unsigned int i = 0 ; i < subs.size() ; i++) {
+                subs[i]->on_resume(tt_ptr);
             }
         } catch (disabled_profiler_exception &e) {
             APEX_UTIL_REF_COUNT_FAILED_RESUME
@@ -842,10 +947,11 @@ profiler* resume(profiler * p) {
     p->restart();
     if (_notify_listeners) {
         try {
-            // skip the profiler_listener - we are restoring a child timer
-            // for a parent that was yielded.
-            for (unsigned int i = 1 ; i < instance->listeners.size() ; i++) {
-                instance->listeners[i]->on_resume(p->tt_ptr);
+            // skip the profiler_listener (always the first subscriber) -
+            // we are restoring a child timer for a parent that was yielded.
+            auto& subs = instance->get_subscribers(listen_resume);
+            for (unsigned int i = 1 ; i < subs.size() ; i++) {
+                subs[i]->on_resume(p->tt_ptr);
             }
         } catch (disabled_profiler_exception &e) {
             APEX_UTIL_REF_COUNT_FAILED_RESUME
@@ -853,8 +959,7 @@ profiler* resume(profiler * p) {
         }
     }
     static std::string apex_process_profile_str("apex::process_profiles");
-    if (p->tt_ptr->get_task_id()->get_name(false).compare(apex_process_profile_str)
-        == 0) {
+    if (p->tt_ptr->get_task_id()->name.compare(apex_process_profile_str) == 0) {
         APEX_UTIL_REF_COUNT_APEX_INTERNAL_RESUME
     } else {
         APEX_UTIL_REF_COUNT_RESUME
@@ -871,8 +976,9 @@ void reset(const std::string &timer_name) {
     task_identifier * id = task_identifier::get_task_id(timer_name);
     //instance->the_profiler_listener->reset(id);
     if (_notify_listeners) {
-        for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-            instance->listeners[i]->on_reset(id);
+        auto& subs = instance->get_subscribers(listen_reset);
+        for (unsigned int i = 0 ; i < subs.size() ; i++) {
+            subs[i]->on_reset(id);
         }
     }
 }
@@ -889,8 +995,9 @@ void reset(apex_function_address function_address) {
     }
     //instance->the_profiler_listener->reset(id);
     if (_notify_listeners) {
-        for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-            instance->listeners[i]->on_reset(id);
+        auto& subs = instance->get_subscribers(listen_reset);
+        for (unsigned int i = 0 ; i < subs.size() ; i++) {
+            subs[i]->on_reset(id);
         }
     }
 }
@@ -906,10 +1013,44 @@ void set_state(apex_thread_state state) {
 void apex::complete_task(std::shared_ptr<task_wrapper> task_wrapper_ptr) {
     apex* instance = apex::instance(); // get the Apex static instance
     if (_notify_listeners) {
-        for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-            instance->listeners[i]->on_task_complete(task_wrapper_ptr);
+        auto& subs = instance->get_subscribers(listen_task_complete);
+        for (unsigned int i = 0 ; i < subs.size() ; i++) {
+            subs[i]->on_task_complete(task_wrapper_ptr);
+        }
+    }
+}
+
+/* Tell the stop (or yield) subscribers.  The profiler listener takes the
+ * profiler by reference, so the shared_ptr (and its control block) is only
+ * made if another listener needs one.  If it wasn't made, the caller frees
+ * the profiler when it is done with it. */
+static std::shared_ptr<profiler> notify_stop(apex * instance,
+    profiler * the_profiler, bool is_yield) {
+    std::shared_ptr<profiler> p;
+    if (!_notify_listeners) { return p; }
+    //read_lock_type l(instance->listener_mutex);
+    auto& subs = instance->get_subscribers(
+        is_yield ? listen_yield : listen_stop);
+    for (unsigned int i = 0 ; i < subs.size() ; i++) {
+        if (subs[i] == instance->the_profiler_listener) {
+            if (is_yield) {
+                instance->the_profiler_listener->on_yield(*the_profiler);
+            } else {
+                instance->the_profiler_listener->on_stop(*the_profiler);
+            }
+            continue;
+        }
+        if (!p) {
+            p = std::shared_ptr<profiler>(the_profiler,
+                std::default_delete<profiler>(), pool_allocator<profiler>());
+        }
+        if (is_yield) {
+            subs[i]->on_yield(p);
+        } else {
+            subs[i]->on_stop(p);
         }
     }
+    return p;
 }
 
 void stop(profiler* the_profiler, bool cleanup) {
@@ -939,27 +1080,22 @@ void stop(profiler* the_profiler, bool cleanup) {
         APEX_UTIL_REF_COUNT_STOP_AFTER_FINALIZE
         return;
     }
-    std::shared_ptr<profiler> p{the_profiler};
-    if (_notify_listeners) {
-        //read_lock_type l(instance->listener_mutex);
-        for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-            instance->listeners[i]->on_stop(p);
-        }
-    }
+    std::shared_ptr<profiler> p = notify_stop(instance, the_profiler, false);
     //cout << thread_instance::get_id() << " Stop : " <<
     //the_profiler->tt_ptr->get_task_id()->get_name() << endl; fflush(stdout);
     static std::string apex_process_profile_str("apex::process_profiles");
-    if (p->tt_ptr->get_task_id()->get_name(false).compare(apex_process_profile_str)
-        == 0) {
+    if (the_profiler->tt_ptr->get_task_id()->name.compare(
+        apex_process_profile_str) == 0) {
         APEX_UTIL_REF_COUNT_APEX_INTERNAL_STOP
     } else {
         APEX_UTIL_REF_COUNT_STOP
     }
     if (cleanup) {
-        instance->complete_task(p->tt_ptr);
-        //instance->active_task_wrappers.erase(p->tt_ptr);
-        p->tt_ptr = nullptr;
+        instance->complete_task(the_profiler->tt_ptr);
+        //instance->active_task_wrappers.erase(the_profiler->tt_ptr);
+        the_profiler->tt_ptr = nullptr;
     }
+    if (!p) { delete the_profiler; }
 }
 
 void stop(std::shared_ptr<task_wrapper> tt_ptr) {
@@ -993,23 +1129,19 @@ void stop(std::shared_ptr<task_wrapper> tt_ptr) {
         APEX_UTIL_REF_COUNT_STOP_AFTER_FINALIZE
         return;
     }
-    std::shared_ptr<profiler> p{tt_ptr->prof};
-    if (_notify_listeners) {
-        //read_lock_type l(instance->listener_mutex);
-        for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-            instance->listeners[i]->on_stop(p);
-        }
-    }
+    profiler * the_profiler = tt_ptr->prof;
+    std::shared_ptr<profiler> p = notify_stop(instance, the_profiler, false);
     //cout << thread_instance::get_id() << " Stop : " <<
     //tt_ptr->get_task_id()->get_name() << endl; fflush(stdout);
     static std::string apex_process_profile_str("apex::process_profiles");
-    if (p->tt_ptr->get_task_id()->get_name(false).compare(apex_process_profile_str)
-        == 0) {
+    if (the_profiler->tt_ptr->get_task_id()->name.compare(
+        apex_process_profile_str) == 0) {
         APEX_UTIL_REF_COUNT_APEX_INTERNAL_STOP
     } else {
         APEX_UTIL_REF_COUNT_STOP
     }
     instance->complete_task(tt_ptr);
+    if (!p) { delete the_profiler; }
 }
 
 void yield(profiler* the_profiler)
@@ -1040,22 +1172,17 @@ void yield(profiler* the_profiler)
     }
     thread_instance::instance().clear_current_profiler(the_profiler, false,
         null_task_wrapper);
-    std::shared_ptr<profiler> p{the_profiler};
-    if (_notify_listeners) {
-        //read_lock_type l(instance->listener_mutex);
-        for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-            instance->listeners[i]->on_yield(p);
-        }
-    }
+    std::shared_ptr<profiler> p = notify_stop(instance, the_profiler, true);
     //cout << thread_instance::get_id() << " Yield : " <<
     //the_profiler->tt_ptr->get_task_id()->get_name() << endl; fflush(stdout);
     static std::string apex_process_profile_str("apex::process_profiles");
-    if (p->tt_ptr->get_task_id()->get_name(false).compare(apex_process_profile_str)
-        == 0) {
+    if (the_profiler->tt_ptr->get_task_id()->name.compare(
+        apex_process_profile_str) == 0) {
         APEX_UTIL_REF_COUNT_APEX_INTERNAL_YIELD
     } else {
         APEX_UTIL_REF_COUNT_YIELD
     }
+    if (!p) { delete the_profiler; }
 }
 
 void yield(std::shared_ptr<task_wrapper> tt_ptr)
@@ -1089,25 +1216,54 @@ void yield(std::shared_ptr<task_wrapper> tt_ptr)
     }
     thread_instance::instance().clear_current_profiler(tt_ptr->prof,
         true, tt_ptr);
-    std::shared_ptr<profiler> p{tt_ptr->prof};
-    if (_notify_listeners) {
-        //read_lock_type l(instance->listener_mutex);
-        for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-            instance->listeners[i]->on_yield(p);
-        }
-    }
+    profiler * the_profiler = tt_ptr->prof;
+    std::shared_ptr<profiler> p = notify_stop(instance, the_profiler, true);
     //cout << thread_instance::get_id() << " Yield : " <<
     //tt_ptr->prof->tt_ptr->get_task_id()->get_name() << endl; fflush(stdout);
     static std::string apex_process_profile_str("apex::process_profiles");
-    if (p->tt_ptr->get_task_id()->get_name(false).compare(apex_process_profile_str)
-        == 0) {
+    if (the_profiler->tt_ptr->get_task_id()->name.compare(
+        apex_process_profile_str) == 0) {
         APEX_UTIL_REF_COUNT_APEX_INTERNAL_YIELD
     } else {
         APEX_UTIL_REF_COUNT_YIELD
     }
+    if (!p) { delete the_profiler; }
     tt_ptr->prof = nullptr;
 }
 
+/* Work out which thread an HPX counter describes, from its name:
+ * either /threadqueue{locality#0/total}/length
+ * or     /threadqueue{locality#0/worker-thread#0}/length
+ * The answer only depends on the name, so it is worked out once per
+ * identifier and cached for this thread. */
+static int counter_thread_id(task_identifier * id, apex * instance) {
+    static APEX_NATIVE_TLS std::unordered_map<task_identifier*, int> * cache
+        = nullptr;
+    if (cache == nullptr) {
+        cache = new std::unordered_map<task_identifier*, int>();
+    }
+    auto it = cache->find(id);
+    if (it != cache->end()) {
+        return it->second;
+    }
+    int tid = 0;
+    const std::string& name = id->name;
+    if (name.find(instance->m_my_locality) != name.npos) {
+        size_t start = name.find("worker-thread");
+        if (start != name.npos) {
+            // up to the closing bracket (or the next path separator)
+            size_t end = name.find_first_of("}/", start);
+            tid = thread_instance::map_name_to_id(
+                name.substr(start, end - start));
+            if (tid == -1) {
+                tid = 0;
+            }
+        }
+    }
+    cache->insert(std::make_pair(id, tid));
+    return tid;
+}
+
 void sample_value(const std::string &name, double value, bool threaded)
 {
     in_apex prevent_deadlocks;
@@ -1115,42 +1271,30 @@ void sample_value(const std::string &name, double value, bool threaded)
     // cleaned up, checking the options can cause deadlock. This can
     // happen if we are tracking memory.
     if (_exited || _measurement_stopped) return; // protect against calls after finalization
+    sample_value(task_identifier::get_task_id(name), value, threaded);
+}
+
+void sample_value(task_identifier * id, double value, bool threaded)
+{
+    in_apex prevent_deadlocks;
+    // check these before checking the options, because if we have already
+    // cleaned up, checking the options can cause deadlock. This can
+    // happen if we are tracking memory.
+    if (_exited || _measurement_stopped) return; // protect against calls after finalization
+    if (id == nullptr) { return; }
     // if APEX is disabled, do nothing.
     if (apex_options::disable() == true) { return; }
     // if APEX is suspended, do nothing.
     if (apex_options::suspend() == true) { return; }
     apex* instance = apex::instance(); // get the Apex static instance
     if (!instance) return; // protect against calls after finalization
-    // parse the counter name
-    // either /threadqueue{locality#0/total}/length
-    // or     /threadqueue{locality#0/worker-thread#0}/length
-    int tid = 0;
-    if (name.find(instance->m_my_locality) != name.npos)
-    {
-        if (name.find("worker-thread") != name.npos)
-        {
-            string tmp_name = string(name.c_str());
-            // tokenize by / character
-            char* token = strtok(const_cast<char*>(tmp_name.c_str()), "/");
-            while (token!=nullptr) {
-              if (strstr(token, "worker-thread")==nullptr) { break; }
-              token = strtok(nullptr, "/");
-            }
-            if (token != nullptr) {
-              // strip the trailing close bracket
-              token = strtok(token, "}");
-              tid = thread_instance::map_name_to_id(token);
-            }
-            if (tid == -1) {
-                tid = 0;
-            }
-        }
-    }
-    sample_value_event_data data(tid, name, value, threaded);
+    int tid = counter_thread_id(id, instance);
+    sample_value_event_data data(tid, id, value, threaded);
     if (_notify_listeners) {
         //read_lock_type l(instance->listener_mutex);
-        for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-            instance->listeners[i]->on_sample_value(data);
+        auto& subs = instance->get_subscribers(listen_sample_value);
+        for (unsigned int i = 0 ; i < subs.size() ; i++) {
+            subs[i]->on_sample_value(data);
         }
     }
 }
@@ -1202,6 +1346,32 @@ std::shared_ptr<task_wrapper> new_task(
     return tt_ptr;
 }
 
+std::shared_ptr<task_wrapper> new_task(
+    task_identifier * id,
+    const uint64_t task_id,
+    const std::shared_ptr<task_wrapper> parent_task) {
+    in_apex prevent_deadlocks;
+    // if APEX is disabled, do nothing.
+    if (apex_options::disable() == true) { return nullptr; }
+    // if APEX is suspended, do nothing.
+    if (apex_options::suspend() == true) { return nullptr; }
+    if (id == nullptr) {
+        APEX_UTIL_REF_COUNT_NULL_TASK_WRAPPER
+        return nullptr;
+    }
+    // get the Apex static instance
+    apex* instance = apex::instance();
+    // protect against calls after finalization
+    if (!instance || _exited) {
+        APEX_UTIL_REF_COUNT_NULL_TASK_WRAPPER
+        return nullptr;
+    }
+    std::shared_ptr<task_wrapper>
+        tt_ptr(_new_task(id, task_id, parent_task, instance));
+    APEX_UTIL_REF_COUNT_TASK_WRAPPER
+    return tt_ptr;
+}
+
 std::shared_ptr<task_wrapper> update_task(
     std::shared_ptr<task_wrapper> wrapper,
     const std::string &timer_name) {
@@ -1308,8 +1478,9 @@ void custom_event(apex_event_type event_type, void * custom_data) {
     custom_event_data data(event_type, custom_data);
     if (_notify_listeners) {
         //read_lock_type l(instance->listener_mutex);
-        for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-            instance->listeners[i]->on_custom_event(data);
+        auto& subs = instance->get_subscribers(listen_custom_event);
+        for (unsigned int i = 0 ; i < subs.size() ; i++) {
+            subs[i]->on_custom_event(data);
         }
     }
 }
@@ -1878,7 +2049,7 @@ apex_profile* get_profile(apex_function_address action_address) {
     in_apex prevent_deadlocks;
     // if APEX is disabled, do nothing.
     if (apex_options::disable() == true) { return nullptr; }
-    task_identifier id(action_address);
+    task_identifier * id = task_identifier::get_task_id(action_address);
     profile * tmp = apex::__instance()->the_profiler_listener->get_profile(id);
     if (tmp != nullptr)
         return tmp->get_profile();
@@ -1889,7 +2060,7 @@ apex_profile* get_profile(const std::string &timer_name) {
     in_apex prevent_deadlocks;
     // if APEX is disabled, do nothing.
     if (apex_options::disable() == true) { return nullptr; }
-    task_identifier id(timer_name);
+    task_identifier * id = task_identifier::get_task_id(timer_name);
     profile * tmp = apex::__instance()->the_profiler_listener->get_profile(id);
     if (tmp != nullptr)
         return tmp->get_profile();
@@ -1906,6 +2077,50 @@ apex_profile* get_profile(const task_identifier &task_id) {
     return nullptr;
 }
 
+bool get_profile_snapshot(apex_function_address action_address,
+    apex_profile &snapshot) {
+    in_apex prevent_deadlocks;
+    // if APEX is disabled, do nothing.
+    if (apex_options::disable() == true) { return false; }
+    task_identifier * id = task_identifier::get_task_id(action_address);
+    profile * tmp = apex::__instance()->the_profiler_listener->get_profile(id);
+    if (tmp == nullptr) { return false; }
+    tmp->snapshot(snapshot);
+    return true;
+}
+
+bool get_profile_snapshot(const std::string &timer_name,
+    apex_profile &snapshot) {
+    in_apex prevent_deadlocks;
+    // if APEX is disabled, do nothing.
+    if (apex_options::disable() == true) { return false; }
+    task_identifier * id = task_identifier::get_task_id(timer_name);
+    profile * tmp = apex::__instance()->the_profiler_listener->get_profile(id);
+    if (tmp == nullptr) { return false; }
+    tmp->snapshot(snapshot);
+    return true;
+}
+
+double get_percentile(apex_function_address action_address, double percent) {
+    in_apex prevent_deadlocks;
+    // if APEX is disabled, do nothing.
+    if (apex_options::disable() == true) { return 0.0; }
+    task_identifier * id = task_identifier::get_task_id(action_address);
+    profile * tmp = apex::__instance()->the_profiler_listener->get_profile(id);
+    if (tmp == nullptr) { return 0.0; }
+    return tmp->get_percentile(percent);
+}
+
+double get_percentile(const std::string &timer_name, double percent) {
+    in_apex prevent_deadlocks;
+    // if APEX is disabled, do nothing.
+    if (apex_options::disable() == true) { return 0.0; }
+    task_identifier * id = task_identifier::get_task_id(timer_name);
+    profile * tmp = apex::__instance()->the_profiler_listener->get_profile(id);
+    if (tmp == nullptr) { return 0.0; }
+    return tmp->get_percentile(percent);
+}
+
 double current_power_high(void) {
     double power = 0.0;
 #ifdef APEX_HAVE_RCR
@@ -1956,8 +2171,9 @@ void send (uint64_t tag, uint64_t size, uint64_t target) {
         message_event_data data(tag, size, instance->get_node_id(), 0, target);
         if (_notify_listeners) {
             //read_lock_type l(instance->listener_mutex);
-            for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-                instance->listeners[i]->on_send(data);
+            auto& subs = instance->get_subscribers(listen_send);
+            for (unsigned int i = 0 ; i < subs.size() ; i++) {
+                subs[i]->on_send(data);
             }
         }
     }
@@ -1986,8 +2202,9 @@ void recv (uint64_t tag, uint64_t size, uint64_t source_rank, uint64_t
             instance->get_node_id());
         if (_notify_listeners) {
             //read_lock_type l(instance->listener_mutex);
-            for (unsigned int i = 0 ; i < instance->listeners.size() ; i++) {
-                instance->listeners[i]->on_recv(data);
+            auto& subs = instance->get_subscribers(listen_recv);
+            for (unsigned int i = 0 ; i < subs.size() ; i++) {
+                subs[i]->on_recv(data);
             }
         }
     }
@@ -2054,8 +2271,8 @@ extern "C" {
             reinterpret_cast<apex_profiler_handle>(
                 start((apex_function_address)identifier));
         } else if (type == APEX_NAME_STRING) {
-            string tmp((const char *)identifier);
-            return reinterpret_cast<apex_profiler_handle>(start(tmp));
+            return reinterpret_cast<apex_profiler_handle>(
+                start((const char *)identifier));
         }
         return APEX_NULL_PROFILER_HANDLE;
     }
@@ -2169,6 +2386,18 @@ extern "C" {
         return nullptr;
     }
 
+    double apex_get_percentile(apex_profiler_type type,
+        void * identifier, double percent) {
+        APEX_ASSERT(identifier != nullptr);
+        if (type == APEX_FUNCTION_ADDRESS) {
+            return get_percentile((apex_function_address)(identifier),
+                percent);
+        } else {
+            string tmp((const char *)identifier);
+            return get_percentile(tmp, percent);
+        }
+    }
+
     double apex_current_power_high() {
         return current_power_high();
     }
@@ -413,6 +413,22 @@ APEX_EXPORT void apex_deregister_policy(apex_policy_handle * handle);
 APEX_EXPORT apex_profile * apex_get_profile(apex_profiler_type type,
     void * identifier);
 
+/**
+ \brief Get a percentile of the call durations for the specified timer.
+
+ Requires APEX_TIMER_HISTOGRAMS.  The result is accurate to within one
+ histogram bucket (about 3%).
+
+ \param type The type of the address to be returned. This can be one of the @ref
+             apex_profiler_type values.
+ \param identifier The function address of the function to be returned, or a "const
+             char *" pointer to the name of the timer.
+ \param percent The percentile, from 0 to 100 (e.g. 99 for the p99).
+ \return The duration in nanoseconds, or 0.0 if there is no histogram.
+ */
+APEX_EXPORT double apex_get_percentile(apex_profiler_type type,
+    void * identifier, double percent);
+
 /**
  \brief Get the current power reading
 
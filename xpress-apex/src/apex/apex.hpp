@@ -88,6 +88,10 @@ private:
 #endif
         m_my_locality(std::string("0"))
     {
+        static const subscriber_list no_subscribers;
+        for (unsigned int e = 0 ; e < listen_event_count ; e++) {
+            subscribers[e].store(&no_subscribers);
+        }
         _initialize();
     };
     apex(apex const&);            // copy constructor is private
@@ -113,6 +117,18 @@ public:
 #endif
     std::string version_string;
     std::vector<event_listener*> listeners;
+    /* The listeners subscribed to each of the frequent events, in the
+     * same order as listeners - so the profiler_listener is first.  The
+     * hot paths read these without a lock, so a published list is never
+     * modified: update_subscribers() publishes a new one, and the old
+     * ones are kept in subscriber_lists until shutdown. */
+    typedef std::vector<event_listener*> subscriber_list;
+    std::atomic<const subscriber_list*> subscribers[listen_event_count];
+    std::vector<const subscriber_list*> subscriber_lists;
+    const subscriber_list& get_subscribers(listener_event e) const {
+        return *(subscribers[e].load(std::memory_order_acquire));
+    }
+    void update_subscribers(void);
     std::vector<int (*)()> finalize_functions;
     std::string m_my_locality;
     std::unordered_map<int, std::string> custom_event_names;
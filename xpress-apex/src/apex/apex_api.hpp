@@ -28,6 +28,7 @@
 #include "task_wrapper.hpp"
 #include <functional>
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <set>
 #include <vector>
@@ -138,6 +139,25 @@ APEX_EXPORT void cleanup(void);
  */
 APEX_EXPORT profiler * start(const std::string &timer_name);
 
+/**
+ \brief Start a timer.
+
+ This function will create a profiler object in APEX, and return a
+ handle to the object.  The object will be associated with the name
+ passed in to this function.  Unlike the std::string version, no string
+ is built: names are resolved through a per-thread cache keyed on the
+ address of the string, so repeated starts with the same literal (or
+ __func__) don't allocate, lock or hash the name.
+
+ \param timer_name The name of the timer, as a null terminated string.
+ \return The handle for the timer object in APEX. Not intended to be
+         queried by the application. Should be retained locally, if
+         possible, and passed in to the matching apex::stop()
+         call when the timer should be stopped.
+ \sa @ref apex::stop, @ref apex::yield, @ref apex::resume
+ */
+APEX_EXPORT profiler * start(const char * timer_name);
+
 /**
  \brief Start a timer.
 
@@ -154,6 +174,26 @@ APEX_EXPORT profiler * start(const std::string &timer_name);
  */
 APEX_EXPORT profiler * start(const apex_function_address function_address);
 
+/**
+ \brief Start a timer.
+
+ This function will create a profiler object in APEX, and return a
+ handle to the object.  The object will be associated with the
+ task_identifier passed in to this function.  Unlike the name-based
+ version, no string is built, hashed or looked up, so callers that
+ start the same timer many times (i.e. tool hooks) can resolve the
+ identifier once and reuse it.  The identifier must not be freed
+ before APEX has finalized.
+
+ \param id A task_identifier, typically from apex::task_identifier::get_task_id
+ \return The handle for the timer object in APEX. Not intended to be
+         queried by the application. Should be retained locally, if
+         possible, and passed in to the matching apex::stop
+         call when the timer should be stopped.
+ \sa @ref apex::stop, @ref apex::yield, @ref apex::resume
+ */
+APEX_EXPORT profiler * start(task_identifier * id);
+
 /**
  \brief Start a timer.
 
@@ -337,6 +377,23 @@ APEX_EXPORT void set_state(apex_thread_state state);
  */
 APEX_EXPORT void sample_value(const std::string &name, double value, bool threaded = false);
 
+/**
+ \brief Sample a state value.
+
+ This function will retain a sample of some value. The profile
+ for this sampled value will store the min, mean, max, total
+ and standard deviation for this value for all times it is sampled.
+ Unlike the name-based version, the name is not looked up, searched or
+ copied, so high frequency counters should resolve the identifier once
+ (i.e. with APEX_STATIC_TASK_ID) and use this.
+
+ \param id The task_identifier of the sampled value
+ \param value The sampled value
+ \param threaded Whether this is a per-thread value, or process-wide
+ \return No return value.
+ */
+APEX_EXPORT void sample_value(task_identifier * id, double value, bool threaded = false);
+
 /**
  \brief Create a new task (dependency).
 
@@ -374,6 +431,25 @@ APEX_EXPORT std::shared_ptr<task_wrapper> new_task(
     const uint64_t task_id = UINTMAX_MAX,
     const std::shared_ptr<apex::task_wrapper> parent_task = null_task_wrapper);
 
+/**
+ \brief Create a new task (dependency).
+
+ This function will note a task dependency between the current
+ timer (task) and the new task.  No name lookup is done, see
+ @ref APEX_STATIC_TASK_ID.
+
+ \param id The task_identifier of the timer.
+ \param task_id The ID of the task (default of -1 implies none provided by runtime)
+ \param parent_task The apex::task_wrapper (if available) that is the parent
+        task of this task
+ \return pointer to an apex::task_wrapper object
+ */
+
+APEX_EXPORT std::shared_ptr<task_wrapper> new_task(
+    task_identifier * id,
+    const uint64_t task_id = UINTMAX_MAX,
+    const std::shared_ptr<apex::task_wrapper> parent_task = null_task_wrapper);
+
 /**
  \brief Update a task (dependency).
 
@@ -588,6 +664,67 @@ APEX_EXPORT apex_profile* get_profile(const std::string &timer_name);
  */
 APEX_EXPORT apex_profile* get_profile(const task_identifier &task_id);
 
+/**
+ \brief Get a consistent copy of the current profile for the specified
+ function address.
+
+ Like @ref apex::get_profile, but the values are copied out as of the last
+ complete update, so they agree with each other (the accumulated time
+ matches the number of calls).  Taking the copy never blocks the threads
+ that update the profile.
+
+ \param function_address The address of the function.
+ \param snapshot Filled in with the current profile.
+ \return false if there is no profile for that timed function.
+ */
+APEX_EXPORT bool get_profile_snapshot(apex_function_address function_address,
+    apex_profile &snapshot);
+
+/**
+ \brief Get a consistent copy of the current profile for the specified
+ timer or counter name.
+
+ Like @ref apex::get_profile, but the values are copied out as of the last
+ complete update, so they agree with each other (the accumulated time
+ matches the number of calls).  Taking the copy never blocks the threads
+ that update the profile.
+
+ \param timer_name The name of the function or sampled value.
+ \param snapshot Filled in with the current profile.
+ \return false if there is no profile for that name.
+ */
+APEX_EXPORT bool get_profile_snapshot(const std::string &timer_name,
+    apex_profile &snapshot);
+
+/**
+ \brief Get a percentile of the call durations for the specified function
+ address.
+
+ Requires APEX_TIMER_HISTOGRAMS.  The result is accurate to within one
+ histogram bucket (about 3%).  Like @ref apex::get_profile_snapshot, this
+ never blocks the threads that update the profile.
+
+ \param function_address The address of the function.
+ \param percent The percentile, from 0 to 100 (e.g. 99 for the p99).
+ \return The duration in nanoseconds, or 0.0 if there is no histogram.
+ */
+APEX_EXPORT double get_percentile(apex_function_address function_address,
+    double percent);
+
+/**
+ \brief Get a percentile of the call durations for the specified timer.
+
+ Requires APEX_TIMER_HISTOGRAMS.  The result is accurate to within one
+ histogram bucket (about 3%).  Like @ref apex::get_profile_snapshot, this
+ never blocks the threads that update the profile.
+
+ \param timer_name The name of the function.
+ \param percent The percentile, from 0 to 100 (e.g. 99 for the p99).
+ \return The duration in nanoseconds, or 0.0 if there is no histogram.
+ */
+APEX_EXPORT double get_percentile(const std::string &timer_name,
+    double percent);
+
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 
 /**
@@ -885,6 +1022,15 @@ class scoped_timer {
             twp = apex::new_task(func);
             apex::start(twp);
         }
+/**
+ \brief Construct and start an APEX timer.
+
+ \param id The task_identifier used to identify the timer type
+ */
+        scoped_timer(task_identifier * id) : twp(nullptr), timing(true) {
+            twp = apex::new_task(id);
+            apex::start(twp);
+        }
 /**
  \brief Register a new thread with APEX, then construct and start an APEX timer.
 
@@ -908,6 +1054,18 @@ class scoped_timer {
             twp = apex::new_task(func, UINTMAX_MAX, parent);
             apex::start(twp);
         }
+/**
+ \brief Register a new thread with APEX, then construct and start an APEX timer.
+
+ \param id The task_identifier used to identify the timer type
+ \param parent The parent task wrapper (if available) of this new scoped_timer
+ */
+        scoped_timer(task_identifier * id,
+            std::shared_ptr<apex::task_wrapper> parent)
+            : twp(nullptr), timing(true) {
+            twp = apex::new_task(id, UINTMAX_MAX, parent);
+            apex::start(twp);
+        }
 /**
  \brief Start the APEX timer.
 
@@ -988,8 +1146,69 @@ public:
     }
 };
 
+/**
+ \brief Compile time FNV-1a hash of a timer name.
+
+ Used by @ref APEX_STATIC_TASK_ID, so that every use of the same literal
+ shares one task_identifier.  Written as a single recursive return so that
+ it is constexpr in C++11, which limits names to the compiler's constexpr
+ recursion depth (512 characters with the default GCC settings).
+ */
+constexpr uint64_t static_name_hash(const char * name,
+    uint64_t hash = 14695981039346656037ULL) {
+    return (*name == 0) ? hash : static_name_hash(name + 1,
+        (hash ^ static_cast<uint64_t>(static_cast<unsigned char>(*name))) *
+        1099511628211ULL);
+}
+
+/**
+ \brief The task_identifier for a timer name known at compile time.
+
+ There is one of these per distinct name hash.  The identifier is resolved
+ the first time get() is called, and after that it is a pointer compare
+ and a load of the static pointer.  Should two names share a hash, the
+ second is looked up by name on every call rather than reported under
+ the first one's identifier.
+ */
+template <uint64_t NameHash>
+struct static_task_id {
+    static task_identifier * get(const char * name) {
+        static const char * first = name;
+        static task_identifier * id =
+            task_identifier::get_task_id(std::string(name));
+        // the same literal can have another address at another call site
+        if (name != first && strcmp(name, first) != 0) {
+            return task_identifier::get_task_id(name);
+        }
+        return id;
+    }
+};
+
 } //namespace apex
 
+/**
+ \brief The task_identifier for a string literal, resolved once.
+
+ The name is hashed at compile time, and the identifier is looked up the
+ first time this line executes.  Use it with apex::start, apex::new_task
+ or apex::scoped_timer in inner loops, where looking up the name every
+ time would cost more than the timer.  The name must be a string literal.
+
+ */
+#define APEX_STATIC_TASK_ID(name) \
+    (apex::static_task_id<apex::static_name_hash(name)>::get(name))
+
+/**
+ \brief A self-stopping timer with a name known at compile time.
+
+ Like APEX_SCOPED_TIMER, but the timer is named by a string literal, which
+ is resolved once (see @ref APEX_STATIC_TASK_ID), so only the identifier
+ pointer is used on every call.
+
+ */
+#define APEX_STATIC_SCOPED_TIMER(name) \
+    apex::scoped_timer __apex_static_timer(APEX_STATIC_TASK_ID(name))
+
 /**
  \brief A convenient macro for inserting an APEX self-stopping timer.
 
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2014-2021 Kevin Huck
+ * Copyright (c) 2014-2021 University of Oregon
+ *
+ * Distributed under the Boost Software License, Version 1.0. (See accompanying
+ * file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#include "apex_clock.hpp"
+#include "apex_options.hpp"
+#include <iostream>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define APEX_HAVE_TSC_CLOCK
+#endif
+
+namespace apex {
+
+apex_clock::source apex_clock::_source = apex_clock::source::system;
+uint64_t apex_clock::_base_ns = 0;
+uint64_t apex_clock::_base_ticks = 0;
+double apex_clock::_ns_per_tick = 1.0;
+
+uint64_t apex_clock::tsc_ns(void) {
+#ifdef APEX_HAVE_TSC_CLOCK
+    // signed, in case this core's counter is a hair behind
+    return _base_ns + static_cast<int64_t>(
+        static_cast<int64_t>(__rdtsc() - _base_ticks) * _ns_per_tick);
+#else
+    // calibrate never picks the TSC without one
+    return system_ns();
+#endif
+}
+
+bool apex_clock::tsc_is_invariant(void) {
+#ifdef APEX_HAVE_TSC_CLOCK
+    unsigned int eax, ebx, ecx, edx;
+    // leaf 0x80000007, EDX bit 8: the TSC runs at a constant rate in all
+    // P-, C- and T-states
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 ||
+        eax < 0x80000007) {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1 << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+void apex_clock::calibrate(const std::string& name) {
+    if (name.compare("tsc") == 0) {
+#ifdef APEX_HAVE_TSC_CLOCK
+        if (tsc_is_invariant()) {
+            /* Count ticks over a short interval of steady time.  Read the
+             * TSC on both sides of each steady_clock call, and use the
+             * midpoint, to take out the cost of the call. */
+            uint64_t t0 = __rdtsc();
+            uint64_t s0 = steady_ns();
+            uint64_t t1 = __rdtsc();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            uint64_t t2 = __rdtsc();
+            uint64_t s1 = steady_ns();
+            uint64_t t3 = __rdtsc();
+            double ticks = ((t2 + t3) / 2.0) - ((t0 + t1) / 2.0);
+            _ns_per_tick = (double)(s1 - s0) / ticks;
+            _base_ticks = __rdtsc();
+            _base_ns = system_ns();
+            _source = source::tsc;
+            if (apex_options::use_verbose()) {
+                std::cout << "APEX: TSC clock, " << (1.0 / _ns_per_tick)
+                          << " ticks per ns" << std::endl;
+            }
+            return;
+        }
+#endif
+        if (apex_options::use_verbose()) {
+            std::cout << "APEX: no invariant TSC, using steady_clock"
+                      << std::endl;
+        }
+    } else if (name.compare("steady") != 0) {
+        if (name.compare("system") != 0) {
+            std::cerr << "APEX: unknown APEX_CLOCK '" << name
+                      << "', using system_clock" << std::endl;
+        }
+        _source = source::system;
+        return;
+    }
+    _base_ticks = steady_ns();
+    _base_ns = system_ns();
+    _source = source::steady;
+}
+
+const char * apex_clock::name(void) {
+    switch (_source) {
+    case source::tsc:
+        return "tsc";
+    case source::steady:
+        return "steady";
+    default:
+        return "system";
+    }
+}
+
+}
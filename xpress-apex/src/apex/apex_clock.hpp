@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2014-2021 Kevin Huck
+ * Copyright (c) 2014-2021 University of Oregon
+ *
+ * Distributed under the Boost Software License, Version 1.0. (See accompanying
+ * file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace apex {
+
+/* The timestamp source behind profiler::now_ns(), selected with
+ * APEX_CLOCK:
+ *   system - std::chrono::system_clock (the default)
+ *   steady - std::chrono::steady_clock
+ *   tsc    - the invariant time stamp counter, calibrated against
+ *            steady_clock at apex::init.  If the TSC isn't invariant (or
+ *            this isn't x86), steady_clock is used instead.
+ * The steady and tsc clocks are anchored to system_clock when they are
+ * calibrated, so every source reports nanoseconds since the epoch and
+ * the trace and GPU activity timestamps still line up. */
+class apex_clock {
+public:
+    enum class source { system, steady, tsc };
+    static uint64_t now_ns(void) {
+        switch (_source) {
+        case source::tsc:
+            return tsc_ns();
+        case source::steady:
+            return _base_ns + (steady_ns() - _base_ticks);
+        default:
+            return system_ns();
+        }
+    }
+    /* Pick the source by name and calibrate it.  Called from apex::init,
+     * before that the system clock is used. */
+    static void calibrate(const std::string& name);
+    static bool tsc_is_invariant(void);
+    static const char * name(void);
+    /* Out of line, so the intrinsics header stays out of ours */
+    static uint64_t tsc_ns(void);
+    static uint64_t system_ns(void) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    static uint64_t steady_ns(void) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+private:
+    static source _source;
+    static uint64_t _base_ns;
+    static uint64_t _base_ticks;
+    static double _ns_per_tick;
+};
+
+}
@@ -23,31 +23,2092 @@
 #include <mutex>
 #include <stack>
 #include <vector>
+#include <deque>
+#include <fstream>
 #include <set>
+#include <map>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <tuple>
+#include <cmath>
 #include <unordered_map>
 #include <stdlib.h>
+#include <atomic>
+#include <cstring>
+#include <dlfcn.h>
 #include "apex.hpp"
 #include "Kokkos_Profiling_C_Interface.h"
+#include "trace_event_listener.hpp"
+#include "utils.hpp"
 
-/*
-static std::mutex memory_mtx;
-static std::unordered_map<void*,apex::profiler*>& memory_map() {
-    static std::unordered_map<void*,apex::profiler*> themap;
-    return themap;
-}
-*/
 static std::stack<apex::profiler*>& timer_stack() {
     static APEX_NATIVE_TLS std::stack<apex::profiler*> thestack;
     return thestack;
 }
-static std::mutex section_mtx;
-static std::vector<std::string>& sections() {
-    static std::vector<std::string> thevector;
-    return thevector;
+
+static constexpr uint64_t fnv1a_offset = 14695981039346656037ULL;
+static constexpr uint64_t fnv1a_prime = 1099511628211ULL;
+
+/* FNV-1a, continuing from h so that strings can be hashed piecewise. */
+static inline uint64_t fnv1a(const char * str, uint64_t h) {
+    for (const char * c = str ; *c != '\0' ; c++) {
+        h ^= static_cast<unsigned char>(*c);
+        h *= fnv1a_prime;
+    }
+    return h;
+}
+
+extern "C" void kokkosp_init_library(int loadseq, uint64_t version,
+    uint32_t ndevinfos, KokkosPDeviceInfo* devinfos);
+
+/* Upper bound on the number of tools chained behind APEX, see
+ * kokkos_tool_chain below. */
+static constexpr size_t max_child_tools = 8;
+
+/* Profile sections.  Section ids are handed out densely, so they index
+ * straight into an append-only table of fixed size chunks - chunks are
+ * never moved or freed, so readers need no lock.  Each slot holds one
+ * active profiler and the thread that owns it; when a section is already
+ * active (another thread, or a nested start on this one) the extra
+ * activation goes on a locked overflow list for that section instead.
+ * Every activation is numbered per thread, so that stop always takes the
+ * calling thread's newest one, wherever it is.  Timers can only be stopped
+ * on the thread that started them, so when a section is destroyed, the
+ * activations of other threads are handed back to be stopped by their
+ * owner the next time it calls into the table. */
+class section_table {
+private:
+    static constexpr size_t chunk_size = 1024;
+    static constexpr size_t max_chunks = 1024;
+    struct activation {
+        uint64_t owner;
+        uint64_t seq;
+        apex::profiler * p;
+    };
+    struct section {
+        std::atomic<apex::task_identifier*> id;
+        std::atomic<uint64_t> owner; // thread holding the slot, 0 if none
+        std::atomic<apex::profiler*> active;
+        uint64_t active_seq; // only touched by the owner
+        std::atomic<uint32_t> overflowed;
+        std::mutex overflow_mtx;
+        std::vector<activation> overflow;
+        uint32_t child_ids[max_child_tools]; // section ids of chained tools
+        section() : id(nullptr), owner(0), active(nullptr), active_seq(0),
+            overflowed(0), child_ids() {}
+    };
+    std::atomic<uint32_t> _count;
+    std::atomic<section*> _chunks[max_chunks];
+    std::mutex _chunk_mtx; // only taken to allocate a new chunk
+    std::atomic<size_t> _orphan_count;
+    std::mutex _orphan_mtx;
+    std::unordered_map<uint64_t, std::vector<activation> > _orphans;
+    /* Thread tokens are never reused, unlike thread ids */
+    static uint64_t this_thread() {
+        static std::atomic<uint64_t> next(1);
+        static APEX_NATIVE_TLS uint64_t token = 0;
+        if (token == 0) { token = next++; }
+        return token;
+    }
+    static uint64_t next_seq() {
+        static APEX_NATIVE_TLS uint64_t seq = 0;
+        return ++seq;
+    }
+    section * get(uint32_t sec_id) {
+        size_t chunk = sec_id / chunk_size;
+        if (chunk >= max_chunks) { return nullptr; }
+        section * c = _chunks[chunk].load(std::memory_order_acquire);
+        if (c == nullptr) { return nullptr; }
+        return &(c[sec_id % chunk_size]);
+    }
+    static bool newest_first(const activation& a, const activation& b) {
+        return a.seq > b.seq;
+    }
+    /* Stop anything another thread destroyed out from under this one */
+    void reap(uint64_t me) {
+        if (_orphan_count.load(std::memory_order_relaxed) == 0) { return; }
+        std::vector<activation> mine;
+        {
+            std::unique_lock<std::mutex> l(_orphan_mtx);
+            auto it = _orphans.find(me);
+            if (it == _orphans.end()) { return; }
+            mine.swap(it->second);
+            _orphans.erase(it);
+            _orphan_count -= mine.size();
+        }
+        std::sort(mine.begin(), mine.end(), newest_first);
+        for (auto& a : mine) { apex::stop(a.p); }
+    }
+public:
+    section_table() : _count(0), _orphan_count(0) {
+        for (size_t i = 0 ; i < max_chunks ; i++) { _chunks[i].store(nullptr); }
+    }
+    uint32_t create(const char * name) {
+        uint32_t sec_id = _count++;
+        size_t chunk = sec_id / chunk_size;
+        if (chunk >= max_chunks) { return sec_id; }
+        if (_chunks[chunk].load(std::memory_order_acquire) == nullptr) {
+            std::unique_lock<std::mutex> l(_chunk_mtx);
+            if (_chunks[chunk].load() == nullptr) {
+                _chunks[chunk].store(new section[chunk_size],
+                    std::memory_order_release);
+            }
+        }
+        get(sec_id)->id.store(apex::task_identifier::get_task_id(name),
+            std::memory_order_release);
+        return sec_id;
+    }
+    uint32_t * child_ids(uint32_t sec_id) {
+        section * s = get(sec_id);
+        return s == nullptr ? nullptr : s->child_ids;
+    }
+    void start(uint32_t sec_id) {
+        uint64_t me = this_thread();
+        reap(me);
+        section * s = get(sec_id);
+        if (s == nullptr) { return; }
+        apex::task_identifier * id = s->id.load(std::memory_order_acquire);
+        if (id == nullptr) { return; }
+        auto p = apex::start(id);
+        uint64_t expected = 0;
+        if (s->owner.compare_exchange_strong(expected, me,
+            std::memory_order_acq_rel)) {
+            s->active_seq = next_seq();
+            s->active.store(p, std::memory_order_release);
+        } else {
+            std::unique_lock<std::mutex> l(s->overflow_mtx);
+            s->overflow.push_back(activation{me, next_seq(), p});
+            s->overflowed++;
+        }
+    }
+    void stop(uint32_t sec_id) {
+        uint64_t me = this_thread();
+        reap(me);
+        section * s = get(sec_id);
+        if (s == nullptr) { return; }
+        bool own = s->owner.load(std::memory_order_acquire) == me;
+        apex::profiler * p = nullptr;
+        // only this thread adds its own entries, so a zero count is exact
+        if (s->overflowed.load(std::memory_order_acquire) > 0) {
+            std::unique_lock<std::mutex> l(s->overflow_mtx);
+            for (auto a = s->overflow.rbegin() ; a != s->overflow.rend() ;
+                 a++) {
+                if (a->owner != me) { continue; }
+                // the slot wins if it was started after this entry
+                if (!own || a->seq > s->active_seq) {
+                    p = a->p;
+                    s->overflow.erase(std::next(a).base());
+                    s->overflowed--;
+                }
+                break;
+            }
+        }
+        if (p == nullptr && own) {
+            p = s->active.exchange(nullptr);
+            s->owner.store(0, std::memory_order_release);
+        }
+        if (p != nullptr) { apex::stop(p); }
+    }
+    void destroy(uint32_t sec_id) {
+        uint64_t me = this_thread();
+        reap(me);
+        section * s = get(sec_id);
+        if (s == nullptr) { return; }
+        std::vector<activation> all;
+        uint64_t owner = s->owner.load(std::memory_order_acquire);
+        apex::profiler * p = s->active.exchange(nullptr);
+        if (p != nullptr) {
+            // the owner set active_seq before it published p
+            all.push_back(activation{owner, s->active_seq, p});
+            s->owner.store(0, std::memory_order_release);
+        }
+        {
+            std::unique_lock<std::mutex> l(s->overflow_mtx);
+            all.insert(all.end(), s->overflow.begin(), s->overflow.end());
+            s->overflow.clear();
+            s->overflowed = 0;
+        }
+        // stop our own newest first, give the rest back to their threads
+        std::sort(all.begin(), all.end(), newest_first);
+        for (auto& a : all) {
+            if (a.owner == me) {
+                apex::stop(a.p);
+            } else {
+                std::unique_lock<std::mutex> l(_orphan_mtx);
+                _orphans[a.owner].push_back(a);
+                _orphan_count++;
+            }
+        }
+    }
+    static section_table& instance() {
+        static section_table table;
+        return table;
+    }
+};
+
+/* Kernel name interning.  Kokkos hands us the same label for every launch
+ * of a kernel, so rather than formatting "Kokkos for, Dev: N, name" and
+ * hashing it again in task_identifier::get_task_id on every launch, map the
+ * (name, kind, device) triple straight to a task_identifier.  The table is a
+ * fixed size, open addressed and insert-only, so lookups never take a lock
+ * or allocate.  Kokkos doesn't promise the label pointer is stable (it is
+ * often the c_str() of a temporary), so slots are keyed on the label bytes
+ * rather than the pointer, and the stored copy is compared before use. */
+enum kernel_kind {
+    kernel_for = 0,
+    kernel_reduce,
+    kernel_scan,
+    kernel_fence
+};
+
+/* Everything we know about one interned kernel - or, with
+ * APEX_KOKKOS_CALLPATH, one kernel under one region path.  The sampling
+ * members are only used when APEX_KOKKOS_SAMPLING is enabled, see
+ * kernel_sampler. */
+class kernel_info {
+public:
+    apex::task_identifier * id;
+    std::atomic<uint64_t> launches;
+    std::atomic<int64_t> countdown;
+    std::atomic<uint32_t> period;
+    std::mutex stats_mtx;
+    uint64_t samples;
+    double sum;
+    double sum_squares;
+    kernel_info() : id(nullptr), launches(0), countdown(0), period(1),
+        samples(0), sum(0.0), sum_squares(0.0) {}
+};
+
+class kernel_name_cache {
+private:
+    static constexpr size_t table_size = 4096; // must be a power of two
+    static constexpr size_t max_probes = 64;
+    enum slot_state { empty = 0, busy, ready };
+    struct slot {
+        std::atomic<int> state;
+        uint64_t hash;
+        uint64_t tag;
+        std::string label;
+        kernel_info info;
+        slot() : state(empty), hash(0), tag(0) {}
+    };
+    slot _slots[table_size];
+    static uint64_t hash(const char * name, uint64_t tag) {
+        return fnv1a(name, fnv1a_offset ^ tag);
+    }
+    static apex::task_identifier * make_id(const char * name,
+        kernel_kind kind, uint32_t devid) {
+        static const char * kinds[] = {"for", "reduce", "scan", "fence"};
+        std::stringstream ss;
+        ss << "Kokkos " << kinds[kind] << ", Dev: " << devid << ", " << name;
+        return apex::task_identifier::get_task_id(ss.str());
+    }
+    /* no kind and device pack to this, see get_info(name, kind, devid) */
+    static constexpr uint64_t qualified_tag = ~(uint64_t)(0);
+    template<typename F> kernel_info * intern(const char * name,
+        uint64_t tag, F make_id) {
+        uint64_t h = hash(name, tag);
+        for (size_t probe = 0 ; probe < max_probes ; probe++) {
+            slot& s = _slots[(h + probe) & (table_size - 1)];
+            int state = s.state.load(std::memory_order_acquire);
+            if (state == empty) {
+                if (s.state.compare_exchange_strong(state, busy,
+                    std::memory_order_acq_rel)) {
+                    s.hash = h;
+                    s.tag = tag;
+                    s.label = name;
+                    s.info.id = make_id();
+                    s.state.store(ready, std::memory_order_release);
+                    return &(s.info);
+                }
+            }
+            // another thread is filling this slot, wait for it
+            while (state == busy) {
+                state = s.state.load(std::memory_order_acquire);
+            }
+            if (s.hash == h && s.tag == tag && s.label.compare(name) == 0) {
+                return &(s.info);
+            }
+        }
+        return nullptr;
+    }
+public:
+    /* Returns nullptr if the table is full around this name */
+    kernel_info * get_info(const char * name, kernel_kind kind,
+        uint32_t devid) {
+        uint64_t tag = (static_cast<uint64_t>(kind) << 32) | devid;
+        return intern(name, tag, [&]() {
+            return make_id(name, kind, devid); });
+    }
+    /* The same, for a timer name that is already fully qualified (a
+     * kernel under a region path), so sampling can be done per timer */
+    kernel_info * get_info(const std::string& name) {
+        return intern(name.c_str(), qualified_tag, [&]() {
+            return apex::task_identifier::get_task_id(name); });
+    }
+    apex::task_identifier * get(const char * name, kernel_kind kind,
+        uint32_t devid) {
+        kernel_info * info = get_info(name, kind, devid);
+        if (info != nullptr) { return info->id; }
+        // Table is saturated around this slot, do it the slow way.
+        return make_id(name, kind, devid);
+    }
+    template<typename F> void for_each(F f) {
+        for (size_t i = 0 ; i < table_size ; i++) {
+            if (_slots[i].state.load(std::memory_order_acquire) == ready) {
+                f(_slots[i].info);
+            }
+        }
+    }
+    static kernel_name_cache& instance() {
+        static kernel_name_cache cache;
+        return cache;
+    }
+};
+
+/* Live memory accounting.  Every allocation is remembered in a sharded
+ * pointer table so that the deallocation hook (which can't be trusted to
+ * come from the same thread) can find the space and View label it belongs
+ * to.  Live bytes and high water marks are kept in atomics per space and
+ * per label, found through a lock-free cache, so the only lock on the hot
+ * path is the shard lock. */
+class memory_stats {
+public:
+    std::string space;
+    std::string label;
+    /* the counters sampled on every allocation, resolved once:
+     * the live bytes in a space, and the size of each allocation
+     * of a label - each is null in the other kind of stats */
+    apex::task_identifier * live_id;
+    apex::task_identifier * bytes_id;
+    std::atomic<int64_t> live;
+    std::atomic<int64_t> high_water;
+    /* the stats for a whole space */
+    explicit memory_stats(const std::string& s) :
+        space(s), bytes_id(nullptr), live(0), high_water(0) {
+        std::stringstream ss;
+        ss << "Kokkos " << space << " live bytes";
+        live_id = apex::task_identifier::get_task_id(ss.str());
+    }
+    /* the stats for one View label in a space */
+    memory_stats(const std::string& s, const std::string& l) :
+        space(s), label(l), live_id(nullptr), live(0), high_water(0) {
+        std::stringstream ss;
+        ss << "Kokkos " << space << " data, " << label << ": Bytes";
+        bytes_id = apex::task_identifier::get_task_id(ss.str());
+    }
+    int64_t update(int64_t bytes) {
+        int64_t now = live.fetch_add(bytes) + bytes;
+        int64_t old = high_water.load();
+        while (now > old && !high_water.compare_exchange_weak(old, now)) {}
+        return now;
+    }
+};
+
+class memory_tracker {
+private:
+    struct allocation {
+        memory_stats * space;
+        memory_stats * label;
+        int64_t size;
+    };
+    struct shard {
+        std::mutex mtx;
+        std::unordered_map<const void*, allocation> allocations;
+    };
+    /* Spaces and labels repeat, so put a lock-free, insert-only table in
+     * front of the maps below, like kernel_name_cache.  Once a (space,
+     * label) pair has been seen, allocating it takes no lock but the shard
+     * lock, and builds no strings. */
+    enum slot_state { empty = 0, busy, ready };
+    struct cache_slot {
+        std::atomic<int> state;
+        uint64_t hash;
+        std::string space;
+        std::string label;
+        memory_stats * space_stats;
+        memory_stats * label_stats;
+        cache_slot() : state(empty), hash(0), space_stats(nullptr),
+            label_stats(nullptr) {}
+    };
+    static constexpr size_t cache_size = 1024; // must be a power of two
+    static constexpr size_t max_probes = 64;
+    cache_slot _cache[cache_size];
+    static constexpr size_t num_shards = 64;
+    shard _shards[num_shards];
+    std::mutex _stats_mtx;
+    std::map<std::string, memory_stats*> _spaces;
+    std::map<std::pair<std::string, std::string>, memory_stats*> _labels;
+    shard& get_shard(const void* ptr) {
+        // allocations are at least 16 byte aligned, so skip those bits
+        return _shards[(reinterpret_cast<uintptr_t>(ptr) >> 4) % num_shards];
+    }
+    memory_stats * get_stats(const char * space, const char * label) {
+        std::unique_lock<std::mutex> l(_stats_mtx);
+        std::pair<std::string, std::string> key{space, label};
+        auto it = _labels.find(key);
+        if (it != _labels.end()) { return it->second; }
+        memory_stats * tmp = new memory_stats(key.first, key.second);
+        _labels.insert(std::make_pair(key, tmp));
+        return tmp;
+    }
+    memory_stats * get_space(const char * space) {
+        std::unique_lock<std::mutex> l(_stats_mtx);
+        std::string key{space};
+        auto it = _spaces.find(key);
+        if (it != _spaces.end()) { return it->second; }
+        memory_stats * tmp = new memory_stats(key);
+        _spaces.insert(std::make_pair(key, tmp));
+        return tmp;
+    }
+    /* Returns nullptr if the table is full around this pair */
+    cache_slot * lookup(const char * space, const char * label) {
+        // the separator keeps ("ab", "c") and ("a", "bc") apart
+        uint64_t h = fnv1a(label, fnv1a(space, fnv1a_offset) ^ 0xff);
+        for (size_t probe = 0 ; probe < max_probes ; probe++) {
+            cache_slot& s = _cache[(h + probe) & (cache_size - 1)];
+            int state = s.state.load(std::memory_order_acquire);
+            if (state == empty) {
+                if (s.state.compare_exchange_strong(state, busy,
+                    std::memory_order_acq_rel)) {
+                    s.hash = h;
+                    s.space = space;
+                    s.label = label;
+                    s.space_stats = get_space(space);
+                    s.label_stats = get_stats(space, label);
+                    s.state.store(ready, std::memory_order_release);
+                    return &s;
+                }
+            }
+            // another thread is filling this slot, wait for it
+            while (state == busy) {
+                state = s.state.load(std::memory_order_acquire);
+            }
+            if (s.hash == h && s.space.compare(space) == 0 &&
+                s.label.compare(label) == 0) {
+                return &s;
+            }
+        }
+        return nullptr;
+    }
+public:
+    void allocate(const char * space, const char * label, const void * ptr,
+        uint64_t size) {
+        allocation a{nullptr, nullptr, static_cast<int64_t>(size)};
+        cache_slot * c = lookup(space, label);
+        if (c != nullptr) {
+            a.space = c->space_stats;
+            a.label = c->label_stats;
+        } else {
+            // table is saturated around this pair, do it the slow way
+            a.space = get_space(space);
+            a.label = get_stats(space, label);
+        }
+        allocation stale{nullptr, nullptr, 0};
+        shard& s = get_shard(ptr);
+        {
+            std::unique_lock<std::mutex> l(s.mtx);
+            auto it = s.allocations.find(ptr);
+            // we missed a deallocation, don't count it twice
+            if (it != s.allocations.end()) {
+                stale = it->second;
+                it->second = a;
+            } else {
+                s.allocations.insert(std::make_pair(ptr, a));
+            }
+        }
+        if (stale.space != nullptr) {
+            stale.label->update(-stale.size);
+            stale.space->update(-stale.size);
+        }
+        apex::sample_value(a.label->bytes_id, (double)(size));
+        a.label->update(a.size);
+        double live = (double)(a.space->update(a.size));
+        apex::sample_value(a.space->live_id, live);
+    }
+    void deallocate(const void * ptr) {
+        allocation a;
+        shard& s = get_shard(ptr);
+        {
+            std::unique_lock<std::mutex> l(s.mtx);
+            auto it = s.allocations.find(ptr);
+            // allocated before we were loaded?
+            if (it == s.allocations.end()) { return; }
+            a = it->second;
+            s.allocations.erase(it);
+        }
+        a.label->update(-a.size);
+        double live = (double)(a.space->update(-a.size));
+        apex::sample_value(a.space->live_id, live);
+    }
+    /* Put the high water marks in the final profile */
+    void report(void) {
+        std::unique_lock<std::mutex> l(_stats_mtx);
+        for (auto it : _spaces) {
+            std::stringstream ss;
+            ss << "Kokkos " << it.first << " high water bytes";
+            apex::sample_value(ss.str(), (double)(it.second->high_water));
+        }
+        for (auto it : _labels) {
+            memory_stats * stats = it.second;
+            std::stringstream ss;
+            ss << "Kokkos " << stats->space << " data, " << stats->label;
+            apex::sample_value(ss.str() + ": High Water Bytes",
+                (double)(stats->high_water));
+            if (stats->live > 0) {
+                apex::sample_value(ss.str() + ": Live Bytes at Exit",
+                    (double)(stats->live));
+            }
+        }
+    }
+    static memory_tracker& instance() {
+        static memory_tracker tracker;
+        return tracker;
+    }
+};
+
+/* Deep copy bandwidth.  The deep copy timer and byte counter are keyed by
+ * View names, so there is no way to get the achieved bandwidth from them.
+ * Aggregate bytes and time per (source space, destination space) pair,
+ * split by copy size, so small latency bound copies don't hide in the
+ * average of the big ones. */
+class deep_copy_tracker {
+public:
+    enum size_bucket { small = 0, medium, large, num_buckets };
+    static size_bucket get_bucket(uint64_t bytes) {
+        if (bytes < 4096) { return small; }
+        if (bytes < 1048576) { return medium; }
+        return large;
+    }
+    static const char * bucket_name(int bucket) {
+        static const char * names[] = {"< 4KB", "< 1MB", ">= 1MB"};
+        return names[bucket];
+    }
+    class bucket_stats {
+    public:
+        std::atomic<uint64_t> copies;
+        std::atomic<uint64_t> bytes;
+        std::atomic<uint64_t> nanoseconds;
+        bucket_stats() : copies(0), bytes(0), nanoseconds(0) {}
+        double gbps(void) const {
+            uint64_t ns = nanoseconds;
+            // bytes per nanosecond is GB/s
+            return ns > 0 ? (double)(bytes) / (double)(ns) : 0.0;
+        }
+    };
+    class pair_stats {
+    public:
+        std::string src;
+        std::string dst;
+        bucket_stats buckets[num_buckets];
+        pair_stats(const std::string& s, const std::string& d) :
+            src(s), dst(d) {}
+    };
+    /* Redundant copy analysis.  A copy is redundant if the same (src,
+     * dst, size) was copied before, and no other deep copy has written to
+     * either end of it in the meantime, and no kernel has been launched
+     * since.  Kokkos doesn't tell us which Views a kernel reads or writes,
+     * so kernels don't clear the state: a repeat with a kernel launch
+     * since the last one is counted as only possibly redundant (it is
+     * redundant if those kernels didn't write the source), and left out
+     * of the savings. */
+    class copy_record {
+    public:
+        std::string src_label;
+        std::string dst_label;
+        uint64_t bytes;
+        uint64_t last_epoch;
+        uint64_t last_sequence;
+        uint64_t copies;
+        uint64_t redundant;
+        uint64_t after_kernels; // possibly redundant, not in redundant
+        uint64_t redundant_nanoseconds;
+        copy_record(const char * src, const char * dst, uint64_t size) :
+            src_label(src), dst_label(dst), bytes(size), last_epoch(0),
+            last_sequence(0), copies(0), redundant(0), after_kernels(0),
+            redundant_nanoseconds(0) {}
+    };
+    static std::atomic<uint64_t>& kernel_epoch() {
+        static std::atomic<uint64_t> epoch{0};
+        return epoch;
+    }
+private:
+    struct active_copy {
+        pair_stats * stats;
+        uint64_t bytes;
+        copy_record * redundant;
+        bool after_kernels;
+        std::chrono::steady_clock::time_point start;
+    };
+    std::mutex _pairs_mtx;
+    std::map<std::pair<std::string, std::string>, pair_stats*> _pairs;
+    typedef std::tuple<const void*, const void*, uint64_t> copy_key;
+    std::mutex _records_mtx;
+    std::map<copy_key, copy_record*> _records;
+    // the copy sequence number that last wrote to each destination
+    std::unordered_map<const void*, uint64_t> _last_written;
+    uint64_t _sequence{0};
+    /* Returns the record if this copy repeats it, and whether a kernel
+     * was launched in between */
+    copy_record * check_redundant(const void * src, const char * src_label,
+        const void * dst, const char * dst_label, uint64_t size,
+        bool& after_kernels) {
+        std::unique_lock<std::mutex> l(_records_mtx);
+        uint64_t epoch = kernel_epoch();
+        uint64_t sequence = ++_sequence;
+        copy_record * record = nullptr;
+        copy_key key{src, dst, size};
+        auto it = _records.find(key);
+        if (it == _records.end()) {
+            record = new copy_record(src_label, dst_label, size);
+            _records.insert(std::make_pair(key, record));
+        } else {
+            record = it->second;
+        }
+        auto last_written = [&](const void * ptr) -> uint64_t {
+            auto w = _last_written.find(ptr);
+            return w == _last_written.end() ? 0 : w->second;
+        };
+        bool repeated = record->copies > 0 &&
+            last_written(src) < record->last_sequence &&
+            last_written(dst) == record->last_sequence;
+        after_kernels = record->last_epoch != epoch;
+        record->copies++;
+        record->last_epoch = epoch;
+        record->last_sequence = sequence;
+        _last_written[dst] = sequence;
+        if (!repeated) { return nullptr; }
+        if (after_kernels) {
+            record->after_kernels++;
+        } else {
+            record->redundant++;
+        }
+        return record;
+    }
+    void report_redundant(void) {
+        std::unique_lock<std::mutex> l(_records_mtx);
+        std::stringstream screen;
+        bool found = false;
+        screen << std::endl << "Kokkos redundant deep copies "
+               << "(same source, destination and size, neither end copied "
+               << "to and no kernel launched since).  Repeats after a kernel "
+               << "are only possibly redundant - if the kernels didn't "
+               << "write the source - and aren't counted as saved:"
+               << std::endl;
+        screen << std::left << std::setw(40) << "source -> destination"
+               << std::right << std::setw(12) << "bytes"
+               << std::setw(12) << "copies" << std::setw(12) << "redundant"
+               << std::setw(16) << "bytes saved" << std::setw(14)
+               << "seconds saved" << std::setw(12) << "possibly"
+               << std::setw(16) << "possible bytes" << std::endl;
+        for (auto it : _records) {
+            copy_record * record = it.second;
+            if (record->redundant == 0 && record->after_kernels == 0) {
+                continue;
+            }
+            found = true;
+            std::string pair_name(record->src_label + " -> " +
+                record->dst_label);
+            uint64_t saved = record->redundant * record->bytes;
+            uint64_t possible = record->after_kernels * record->bytes;
+            double seconds = (double)(record->redundant_nanoseconds) * 1.0e-9;
+            if (record->redundant > 0) {
+                apex::sample_value("Kokkos redundant deep copy: " +
+                    pair_name + ": Bytes", (double)(saved));
+            }
+            if (record->after_kernels > 0) {
+                apex::sample_value("Kokkos possibly redundant deep copy: " +
+                    pair_name + ": Bytes", (double)(possible));
+            }
+            screen << std::left << std::setw(40) << pair_name << std::right
+                   << std::setw(12) << record->bytes
+                   << std::setw(12) << record->copies
+                   << std::setw(12) << record->redundant
+                   << std::setw(16) << saved
+                   << std::setw(14) << std::fixed << std::setprecision(6)
+                   << seconds
+                   << std::setw(12) << record->after_kernels
+                   << std::setw(16) << possible << std::endl;
+        }
+        if (found && apex::apex_options::use_screen_output()) {
+            std::cout << screen.str();
+        }
+    }
+    static std::stack<active_copy>& active_copies() {
+        static APEX_NATIVE_TLS std::stack<active_copy> thestack;
+        return thestack;
+    }
+    pair_stats * get_pair(const char * src, const char * dst) {
+        std::unique_lock<std::mutex> l(_pairs_mtx);
+        std::pair<std::string, std::string> key{src, dst};
+        auto it = _pairs.find(key);
+        if (it != _pairs.end()) { return it->second; }
+        pair_stats * tmp = new pair_stats(key.first, key.second);
+        _pairs.insert(std::make_pair(key, tmp));
+        return tmp;
+    }
+public:
+    void begin(const char * src_space, const void * src,
+        const char * src_label, const char * dst_space, const void * dst,
+        const char * dst_label, uint64_t size) {
+        copy_record * redundant = nullptr;
+        bool after_kernels = false;
+        if (apex::apex_options::use_kokkos_deep_copy_analysis()) {
+            redundant = check_redundant(src, src_label, dst, dst_label, size,
+                after_kernels);
+        }
+        active_copies().push(active_copy{get_pair(src_space, dst_space), size,
+            redundant, after_kernels, std::chrono::steady_clock::now()});
+    }
+    void end(void) {
+        auto end = std::chrono::steady_clock::now();
+        if (active_copies().empty()) { return; }
+        active_copy& c = active_copies().top();
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            end - c.start).count();
+        bucket_stats& b = c.stats->buckets[get_bucket(c.bytes)];
+        b.copies++;
+        b.bytes += c.bytes;
+        b.nanoseconds += ns;
+        if (c.redundant != nullptr && !c.after_kernels) {
+            std::unique_lock<std::mutex> l(_records_mtx);
+            c.redundant->redundant_nanoseconds += ns;
+        }
+        active_copies().pop();
+    }
+    /* Put the bandwidth per space pair and size in the final profile, and
+     * if screen output is on, flag the sizes that get less than half the
+     * bandwidth of the best size for that pair - those copies are paying
+     * mostly latency, and would benefit from being batched. */
+    void report(void) {
+        if (apex::apex_options::use_kokkos_deep_copy_analysis()) {
+            report_redundant();
+        }
+        std::unique_lock<std::mutex> l(_pairs_mtx);
+        if (_pairs.empty()) { return; }
+        std::stringstream screen;
+        screen << std::endl << "Kokkos deep copy bandwidth:" << std::endl;
+        screen << std::left << std::setw(32) << "source -> destination"
+               << std::setw(10) << "size" << std::right
+               << std::setw(12) << "copies" << std::setw(16) << "bytes"
+               << std::setw(14) << "seconds" << std::setw(10) << "GB/s"
+               << std::endl;
+        for (auto it : _pairs) {
+            pair_stats * stats = it.second;
+            std::string pair_name(stats->src + " -> " + stats->dst);
+            double best = 0.0;
+            for (int i = 0 ; i < num_buckets ; i++) {
+                best = std::max(best, stats->buckets[i].gbps());
+            }
+            for (int i = 0 ; i < num_buckets ; i++) {
+                bucket_stats& b = stats->buckets[i];
+                if (b.copies == 0) { continue; }
+                std::stringstream ss;
+                ss << "Kokkos deep copy: " << pair_name << ", "
+                   << bucket_name(i) << ": GB/s";
+                apex::sample_value(ss.str(), b.gbps());
+                screen << std::left << std::setw(32) << pair_name
+                       << std::setw(10) << bucket_name(i) << std::right
+                       << std::setw(12) << b.copies
+                       << std::setw(16) << b.bytes
+                       << std::setw(14) << std::fixed << std::setprecision(6)
+                       << (double)(b.nanoseconds) * 1.0e-9
+                       << std::setw(10) << std::setprecision(3) << b.gbps();
+                if (b.gbps() < 0.5 * best) {
+                    screen << "  <- latency dominated, consider batching";
+                }
+                screen << std::endl;
+            }
+        }
+        if (apex::apex_options::use_screen_output()) {
+            std::cout << screen.str();
+        }
+    }
+    static deep_copy_tracker& instance() {
+        static deep_copy_tracker tracker;
+        return tracker;
+    }
+};
+
+/* Fences.  Each fence is timed by name and by device, and the time spent
+ * waiting is attributed to the last kernel launched on that device that
+ * hasn't been fenced yet.  Fences that find no outstanding kernel are
+ * counted separately - with instance based code, those are the ones that
+ * could likely be removed. */
+class fence_tracker {
+private:
+    static constexpr size_t table_size = 256; // must be a power of two
+    static constexpr size_t max_probes = 16;
+    enum slot_state { empty = 0, busy, ready };
+    struct device {
+        std::atomic<int> state;
+        uint32_t devid;
+        apex::task_identifier * id;
+        std::atomic<apex::task_identifier*> outstanding;
+        device() : state(empty), devid(0), id(nullptr), outstanding(nullptr) {}
+    };
+    device _devices[table_size];
+    struct fence_record {
+        apex::profiler * device_timer;
+        apex::profiler * fence_timer;
+        apex::task_identifier * kernel;
+        std::chrono::steady_clock::time_point start;
+    };
+    /* Fences are synchronous, so they begin and end on the same thread, in
+     * LIFO order.  The handle is the depth of the record on this stack. */
+    static std::vector<fence_record>& active_fences() {
+        static APEX_NATIVE_TLS std::vector<fence_record> * thestack = nullptr;
+        if (thestack == nullptr) {
+            thestack = new std::vector<fence_record>();
+        }
+        return *thestack;
+    }
+    static apex::task_identifier * make_id(uint32_t devid) {
+        std::stringstream ss;
+        ss << "Kokkos fence, Dev: " << devid;
+        return apex::task_identifier::get_task_id(ss.str());
+    }
+    /* Returns nullptr if the table is full around this device */
+    device * get_device(uint32_t devid) {
+        uint64_t h = fnv1a_offset;
+        for (size_t i = 0 ; i < sizeof(devid) ; i++) {
+            h = (h ^ ((devid >> (i * 8)) & 0xff)) * fnv1a_prime;
+        }
+        for (size_t probe = 0 ; probe < max_probes ; probe++) {
+            device& d = _devices[(h + probe) & (table_size - 1)];
+            int state = d.state.load(std::memory_order_acquire);
+            if (state == empty) {
+                if (d.state.compare_exchange_strong(state, busy,
+                    std::memory_order_acq_rel)) {
+                    d.devid = devid;
+                    d.id = make_id(devid);
+                    d.state.store(ready, std::memory_order_release);
+                    return &d;
+                }
+            }
+            // another thread is filling this slot, wait for it
+            while (state == busy) {
+                state = d.state.load(std::memory_order_acquire);
+            }
+            if (d.devid == devid) { return &d; }
+        }
+        return nullptr;
+    }
+public:
+    void launched(uint32_t devid, apex::task_identifier * id) {
+        device * d = get_device(devid);
+        if (d != nullptr) {
+            d->outstanding.store(id, std::memory_order_relaxed);
+        }
+    }
+    uint64_t begin(const char * name, uint32_t devid) {
+        std::vector<fence_record>& stack = active_fences();
+        stack.emplace_back();
+        fence_record& r = stack.back();
+        device * d = get_device(devid);
+        // the fence will complete the outstanding kernel, so take it
+        r.kernel = d == nullptr ? nullptr : d->outstanding.exchange(nullptr);
+        r.device_timer = apex::start(d == nullptr ? make_id(devid) : d->id);
+        r.fence_timer = apex::start(
+            kernel_name_cache::instance().get(name, kernel_fence, devid));
+        r.start = std::chrono::steady_clock::now();
+        return stack.size();
+    }
+    void end(uint64_t handle) {
+        auto end = std::chrono::steady_clock::now();
+        std::vector<fence_record>& stack = active_fences();
+        if (handle == 0 || handle > stack.size()) { return; }
+        fence_record r = stack[handle - 1];
+        stack.resize(handle - 1);
+        apex::stop(r.fence_timer);
+        apex::stop(r.device_timer);
+        double seconds = std::chrono::duration_cast<
+            std::chrono::duration<double>>(end - r.start).count();
+        if (r.kernel != nullptr) {
+            apex::sample_value("Kokkos fence wait: " +
+                r.kernel->get_name(false), seconds);
+        } else {
+            static const std::string no_kernel(
+                "Kokkos fence wait: no outstanding kernel");
+            apex::sample_value(no_kernel, seconds);
+        }
+    }
+    static fence_tracker& instance() {
+        static fence_tracker tracker;
+        return tracker;
+    }
+};
+
+/* Sampled kernel timing.  When there are millions of tiny kernels, timing
+ * each one costs more than the kernels.  Instead, count every launch, but
+ * only time one in N of them per kernel.  After a short warm up, N is
+ * chosen so that the measured cost of a timed launch is at most
+ * APEX_KOKKOS_SAMPLING_OVERHEAD percent of the kernel time it represents.
+ * At exit, the total time is extrapolated from the samples, with a 95%
+ * confidence interval. */
+class kernel_sampler {
+private:
+    static constexpr uint64_t warmup = 10;
+    static constexpr uint32_t max_period = 1 << 16;
+    struct active_kernel {
+        apex::profiler * p;
+        kernel_info * info;
+        std::chrono::steady_clock::time_point start;
+        double overhead;
+    };
+    std::atomic<uint64_t> _overhead_ns;
+    static std::stack<active_kernel>& active() {
+        static APEX_NATIVE_TLS std::stack<active_kernel> thestack;
+        return thestack;
+    }
+    static double seconds(std::chrono::steady_clock::time_point a,
+        std::chrono::steady_clock::time_point b) {
+        return std::chrono::duration_cast<
+            std::chrono::duration<double>>(b - a).count();
+    }
+    void update(kernel_info * info, double duration, double overhead) {
+        // a running average of what a timed launch costs us
+        uint64_t old_ns = _overhead_ns.load(std::memory_order_relaxed);
+        uint64_t new_ns = old_ns == 0 ? (uint64_t)(overhead * 1.0e9) :
+            (uint64_t)(0.9 * old_ns + 0.1 * overhead * 1.0e9);
+        _overhead_ns.store(new_ns, std::memory_order_relaxed);
+        std::unique_lock<std::mutex> l(info->stats_mtx);
+        info->samples++;
+        info->sum += duration;
+        info->sum_squares += duration * duration;
+        if (info->samples < warmup) { return; }
+        double mean = info->sum / info->samples;
+        double fraction =
+            apex::apex_options::kokkos_sampling_overhead() / 100.0;
+        double period = 1.0;
+        if (mean > 0.0 && fraction > 0.0) {
+            period = std::ceil(((double)(new_ns) * 1.0e-9) / (fraction * mean));
+        }
+        info->period.store((uint32_t)(std::min(std::max(period, 1.0),
+            (double)(max_period))), std::memory_order_relaxed);
+    }
+public:
+    kernel_sampler() : _overhead_ns(0) {}
+    bool should_time(kernel_info * info) {
+        info->launches.fetch_add(1, std::memory_order_relaxed);
+        if (info->countdown.fetch_sub(1, std::memory_order_relaxed) > 1) {
+            return false;
+        }
+        info->countdown.store(info->period.load(std::memory_order_relaxed),
+            std::memory_order_relaxed);
+        return true;
+    }
+    /* id is the timer start_kernel resolved, the one info samples */
+    apex::profiler * start(kernel_info * info, apex::task_identifier * id) {
+        auto t0 = std::chrono::steady_clock::now();
+        apex::profiler * p = apex::start(id);
+        auto t1 = std::chrono::steady_clock::now();
+        active().push(active_kernel{p, info, t1, seconds(t0, t1)});
+        return p;
+    }
+    void stop(apex::profiler * p) {
+        auto t2 = std::chrono::steady_clock::now();
+        if (active().empty() || active().top().p != p) {
+            apex::stop(p);
+            return;
+        }
+        active_kernel k = active().top();
+        active().pop();
+        apex::stop(p);
+        auto t3 = std::chrono::steady_clock::now();
+        update(k.info, seconds(k.start, t2), k.overhead + seconds(t2, t3));
+    }
+    void report(void) {
+        std::stringstream screen;
+        screen << std::endl << "Kokkos sampled kernel timing "
+               << "(extrapolated, 95% confidence):" << std::endl;
+        screen << std::left << std::setw(52) << "kernel" << std::right
+               << std::setw(12) << "launches" << std::setw(10) << "sampled"
+               << std::setw(14) << "est. seconds" << std::setw(14)
+               << "+/-" << std::endl;
+        kernel_name_cache::instance().for_each([&](kernel_info& info) {
+            std::unique_lock<std::mutex> l(info.stats_mtx);
+            uint64_t launches = info.launches;
+            if (launches == 0 || info.samples == 0) { return; }
+            double n = (double)(info.samples);
+            double mean = info.sum / n;
+            double variance = std::max(0.0,
+                (info.sum_squares / n) - (mean * mean));
+            // finite population correction, sampling without replacement
+            double fpc = std::sqrt(std::max(0.0, 1.0 - n / (double)(launches)));
+            double estimate = mean * (double)(launches);
+            double bound = 1.96 * std::sqrt(variance / n) * fpc *
+                (double)(launches);
+            std::string name(info.id->get_name(false));
+            apex::sample_value(name + ": Launches", (double)(launches));
+            apex::sample_value(name + ": Estimated Seconds", estimate);
+            apex::sample_value(name + ": Estimated Seconds 95% CI", bound);
+            std::string shortname(name);
+            if (shortname.size() > 50) {
+                shortname.resize(47);
+                shortname.append("...");
+            }
+            screen << std::left << std::setw(52) << shortname << std::right
+                   << std::setw(12) << launches
+                   << std::setw(10) << info.samples
+                   << std::setw(14) << std::scientific << std::setprecision(3)
+                   << estimate << std::setw(14) << bound << std::endl;
+        });
+        if (apex::apex_options::use_screen_output()) {
+            std::cout << screen.str();
+        }
+    }
+    static kernel_sampler& instance() {
+        static kernel_sampler sampler;
+        return sampler;
+    }
+};
+
+/* Execution space instances.  Kokkos packs the device type, device and
+ * instance into the devid passed to the hooks.  With
+ * APEX_KOKKOS_INSTANCE_ANALYSIS enabled, keep a running sweep over kernel,
+ * deep copy and fence begin/end events to measure how long each instance
+ * is busy, how much each pair of instances overlaps, and how long deep
+ * copies (and the fences they imply) run with no instance busy at all.
+ * If trace events are enabled, each instance also gets its own virtual
+ * thread in the trace.  For asynchronous backends the kernel hooks return
+ * before the kernel does, so APEX_KOKKOS_PROFILING_FENCES should be on for
+ * the intervals to mean anything. */
+class instance_timeline {
+private:
+    static constexpr size_t max_instances = 64;
+    /* From Kokkos_Profiling.hpp: 8 bits of type, 7 of device, 17 of
+     * instance, and a special id for deep copy resource fences. */
+    static constexpr uint32_t num_type_bits = 8;
+    static constexpr uint32_t num_device_bits = 7;
+    static constexpr uint32_t num_instance_bits = 17;
+    static constexpr uint32_t deep_copy_fence_id = 0x00ffffff;
+    struct instance_state {
+        uint32_t devid;
+        uint32_t active;
+        uint64_t busy_ns;
+    };
+    struct active_kernel {
+        uint32_t devid;
+        apex::task_identifier * id;
+        uint64_t start_ns;
+    };
+    std::mutex _mtx;
+    std::vector<instance_state> _instances;
+    uint64_t _overlap_ns[max_instances][max_instances];
+    uint64_t _first_ns;
+    uint64_t _last_ns;
+    uint32_t _copies_active;
+    uint32_t _copy_fences_active;
+    uint64_t _serialized_ns;
+    uint64_t _copy_ns;
+    static std::stack<active_kernel>& active_kernels() {
+        static APEX_NATIVE_TLS std::stack<active_kernel> thestack;
+        return thestack;
+    }
+    static std::stack<bool>& active_fences() {
+        static APEX_NATIVE_TLS std::stack<bool> thestack;
+        return thestack;
+    }
+    static apex::kokkos_thread_node decode(uint32_t devid) {
+        return apex::kokkos_thread_node(
+            devid >> (num_device_bits + num_instance_bits),
+            (devid >> num_instance_bits) & ((1u << num_device_bits) - 1),
+            devid & ((1u << num_instance_bits) - 1));
+    }
+    static std::string instance_name(uint32_t devid) {
+        static const char * types[] = {"Serial", "OpenMP", "Cuda", "HIP",
+            "OpenMPTarget", "HPX", "Threads", "SYCL", "OpenACC", "Unknown"};
+        apex::kokkos_thread_node node = decode(devid);
+        std::stringstream ss;
+        ss << types[std::min(node._type, 9u)] << " [" << node._device << ":"
+           << node._instance << "]";
+        return ss.str();
+    }
+    size_t get_index(uint32_t devid) {
+        for (size_t i = 0 ; i < _instances.size() ; i++) {
+            if (_instances[i].devid == devid) { return i; }
+        }
+        if (_instances.size() == max_instances) { return max_instances; }
+        _instances.push_back(instance_state{devid, 0, 0});
+        return _instances.size() - 1;
+    }
+    /* account for the time since the last event, must hold the lock */
+    void advance(uint64_t now) {
+        if (_first_ns == 0) { _first_ns = now; }
+        uint64_t delta = now > _last_ns && _last_ns > 0 ? now - _last_ns : 0;
+        _last_ns = std::max(now, _last_ns);
+        if (delta == 0) { return; }
+        bool any_busy = false;
+        for (size_t i = 0 ; i < _instances.size() ; i++) {
+            if (_instances[i].active == 0) { continue; }
+            any_busy = true;
+            _instances[i].busy_ns += delta;
+            for (size_t j = i + 1 ; j < _instances.size() ; j++) {
+                if (_instances[j].active > 0) { _overlap_ns[i][j] += delta; }
+            }
+        }
+        if (_copies_active > 0 || _copy_fences_active > 0) {
+            _copy_ns += delta;
+            if (!any_busy) { _serialized_ns += delta; }
+        }
+    }
+public:
+    instance_timeline() : _first_ns(0), _last_ns(0), _copies_active(0),
+        _copy_fences_active(0), _serialized_ns(0), _copy_ns(0) {
+        memset(_overlap_ns, 0, sizeof(_overlap_ns));
+    }
+    void begin_kernel(uint32_t devid, apex::task_identifier * id) {
+        uint64_t now = apex::profiler::now_ns();
+        active_kernels().push(active_kernel{devid, id, now});
+        std::unique_lock<std::mutex> l(_mtx);
+        advance(now);
+        size_t index = get_index(devid);
+        if (index < max_instances) { _instances[index].active++; }
+    }
+    void end_kernel(void) {
+        uint64_t now = apex::profiler::now_ns();
+        if (active_kernels().empty()) { return; }
+        active_kernel k = active_kernels().top();
+        active_kernels().pop();
+        {
+            std::unique_lock<std::mutex> l(_mtx);
+            advance(now);
+            size_t index = get_index(k.devid);
+            if (index < max_instances && _instances[index].active > 0) {
+                _instances[index].active--;
+            }
+        }
+        if (apex::apex_options::use_trace_event()) {
+            apex::trace_event_listener * tel =
+                (apex::trace_event_listener*)
+                apex::apex::instance()->the_trace_event_listener;
+            apex::kokkos_thread_node node = decode(k.devid);
+            tel->on_kokkos_instance_event(node, k.id->get_name(false),
+                k.start_ns, now);
+        }
+    }
+    void begin_deep_copy(void) {
+        std::unique_lock<std::mutex> l(_mtx);
+        advance(apex::profiler::now_ns());
+        _copies_active++;
+    }
+    void end_deep_copy(void) {
+        std::unique_lock<std::mutex> l(_mtx);
+        advance(apex::profiler::now_ns());
+        if (_copies_active > 0) { _copies_active--; }
+    }
+    /* Kokkos::deep_copy without an instance fences everything first */
+    void begin_fence(const char * name, uint32_t devid) {
+        bool copy_fence = devid == deep_copy_fence_id ||
+            strstr(name, "deep_copy") != nullptr;
+        active_fences().push(copy_fence);
+        if (!copy_fence) { return; }
+        std::unique_lock<std::mutex> l(_mtx);
+        advance(apex::profiler::now_ns());
+        _copy_fences_active++;
+    }
+    void end_fence(void) {
+        if (active_fences().empty()) { return; }
+        bool copy_fence = active_fences().top();
+        active_fences().pop();
+        if (!copy_fence) { return; }
+        std::unique_lock<std::mutex> l(_mtx);
+        advance(apex::profiler::now_ns());
+        if (_copy_fences_active > 0) { _copy_fences_active--; }
+    }
+    void report(void) {
+        std::unique_lock<std::mutex> l(_mtx);
+        if (_instances.empty()) { return; }
+        double window = (double)(_last_ns - _first_ns) * 1.0e-9;
+        std::stringstream screen;
+        screen << std::endl << "Kokkos execution space instances ("
+               << std::fixed << std::setprecision(6) << window
+               << " seconds observed):" << std::endl;
+        for (size_t i = 0 ; i < _instances.size() ; i++) {
+            std::string name(instance_name(_instances[i].devid));
+            double busy = (double)(_instances[i].busy_ns) * 1.0e-9;
+            apex::sample_value("Kokkos instance " + name + ": Busy Seconds",
+                busy);
+            screen << "  " << std::left << std::setw(36) << name << std::right
+                   << " busy " << std::setw(12) << busy << " s ("
+                   << std::setprecision(2) << std::setw(6)
+                   << (window > 0.0 ? 100.0 * busy / window : 0.0) << "%)"
+                   << std::setprecision(6) << std::endl;
+        }
+        for (size_t i = 0 ; i < _instances.size() ; i++) {
+            for (size_t j = i + 1 ; j < _instances.size() ; j++) {
+                uint64_t shorter = std::min(_instances[i].busy_ns,
+                    _instances[j].busy_ns);
+                double fraction = shorter > 0 ?
+                    (double)(_overlap_ns[i][j]) / (double)(shorter) : 0.0;
+                std::string pair_name(instance_name(_instances[i].devid) +
+                    " / " + instance_name(_instances[j].devid));
+                apex::sample_value("Kokkos instance overlap: " + pair_name,
+                    fraction);
+                screen << "  overlap " << std::left << std::setw(46)
+                       << pair_name << std::right << std::setprecision(2)
+                       << std::setw(6) << 100.0 * fraction
+                       << "% of the less busy instance"
+                       << std::setprecision(6) << std::endl;
+            }
+        }
+        double copies = (double)(_copy_ns) * 1.0e-9;
+        double serialized = (double)(_serialized_ns) * 1.0e-9;
+        apex::sample_value("Kokkos deep copy: Serialized Seconds", serialized);
+        screen << "  deep copies and their fences: " << copies
+               << " s, with no instance busy: " << serialized << " s"
+               << std::endl;
+        if (apex::apex_options::use_screen_output()) {
+            std::cout << screen.str();
+        }
+    }
+    static instance_timeline& instance() {
+        static instance_timeline timeline;
+        return timeline;
+    }
+};
+
+/* The region stack of the calling thread as a "/" separated path.  The
+ * FNV-1a hash of the path is extended by each push and the previous value
+ * restored by each pop, so consumers can key on the path without hashing
+ * it again. */
+class region_path {
+private:
+    std::string _path;
+    uint64_t _hash;
+    std::vector<std::pair<size_t, uint64_t> > _saved;
+    region_path() : _hash(fnv1a_offset) {}
+public:
+    void push(const char * name) {
+        _saved.push_back(std::make_pair(_path.size(), _hash));
+        if (!_path.empty()) {
+            _path.push_back('/');
+            _hash = fnv1a("/", _hash);
+        }
+        _path.append(name);
+        _hash = fnv1a(name, _hash);
+    }
+    void pop(void) {
+        if (_saved.empty()) { return; }
+        _path.resize(_saved.back().first);
+        _hash = _saved.back().second;
+        _saved.pop_back();
+    }
+    const std::string& path(void) const { return _path; }
+    uint64_t hash(void) const { return _hash; }
+    static region_path& instance() {
+        static APEX_NATIVE_TLS region_path * thepath = nullptr;
+        if (thepath == nullptr) { thepath = new region_path(); }
+        return *thepath;
+    }
+};
+
+/* In-situ aggregation of Kokkos events, grouped by the attributes listed
+ * in APEX_KOKKOS_GROUP_BY (any of kernel, region, space, device, tuning,
+ * comma separated - the event type is always part of the key).  Attributes
+ * that aren't listed are dropped from the key, so their events collapse
+ * together.  Each thread aggregates into its own open addressed table,
+ * under that table's lock - which only the report at finalize contends
+ * for; the tables are merged and written to
+ * apex_kokkos_group_by.<node>.csv then. */
+class group_by {
+public:
+    enum event_kind { event_kernel = 0, event_fence, event_deep_copy,
+        event_allocation, num_event_kinds };
+private:
+    enum field { field_kernel = 0, field_region, field_space, field_device,
+        field_tuning, num_fields };
+    struct entry {
+        uint64_t hash;
+        event_kind kind;
+        std::string label;
+        std::string region;
+        std::string space;
+        uint32_t device;
+        std::string tuning;
+        uint64_t count;
+        uint64_t nanoseconds;
+        uint64_t bytes;
+    };
+    /* One per thread.  Entries live in a deque so pointers to them stay
+     * valid while the index grows.  Only the owning thread writes, with mtx
+     * held, so that report() can read while it does. */
+    class table {
+    public:
+        std::mutex mtx;
+    private:
+        std::deque<entry> _entries;
+        std::vector<entry*> _index;
+        void grow(void) {
+            std::vector<entry*> tmp(_index.empty() ? 256 : _index.size() * 2,
+                nullptr);
+            for (entry& e : _entries) {
+                size_t i = e.hash & (tmp.size() - 1);
+                while (tmp[i] != nullptr) { i = (i + 1) & (tmp.size() - 1); }
+                tmp[i] = &e;
+            }
+            _index.swap(tmp);
+        }
+    public:
+        entry * find(uint64_t h, event_kind kind, const char * label,
+            const std::string * region, const char * space, uint32_t device,
+            const std::string * tuning) {
+            if ((_entries.size() + 1) * 2 > _index.size()) { grow(); }
+            size_t i = h & (_index.size() - 1);
+            for ( ; _index[i] != nullptr ; i = (i + 1) & (_index.size() - 1)) {
+                entry * e = _index[i];
+                if (e->hash == h && e->kind == kind && e->device == device &&
+                    e->label.compare(label) == 0 &&
+                    e->space.compare(space) == 0 &&
+                    (region == nullptr || e->region == *region) &&
+                    (tuning == nullptr || e->tuning == *tuning)) {
+                    return e;
+                }
+            }
+            _entries.push_back(entry{h, kind, label,
+                region == nullptr ? std::string() : *region, space, device,
+                tuning == nullptr ? std::string() : *tuning, 0, 0, 0});
+            _index[i] = &(_entries.back());
+            return _index[i];
+        }
+        const std::deque<entry>& entries(void) const { return _entries; }
+    };
+    struct active_event {
+        entry * e;
+        std::chrono::steady_clock::time_point start;
+    };
+    bool _enabled;
+    bool _fields[num_fields];
+    std::vector<field> _order;
+    std::mutex _tables_mtx;
+    std::vector<table*> _tables;
+    table& my_table(void) {
+        static APEX_NATIVE_TLS table * thetable = nullptr;
+        if (thetable == nullptr) {
+            thetable = new table();
+            std::unique_lock<std::mutex> l(_tables_mtx);
+            _tables.push_back(thetable);
+        }
+        return *thetable;
+    }
+    static std::vector<active_event>& active_events() {
+        static APEX_NATIVE_TLS std::vector<active_event> * thestack = nullptr;
+        if (thestack == nullptr) {
+            thestack = new std::vector<active_event>();
+        }
+        return *thestack;
+    }
+    static const char * field_name(int f) {
+        static const char * names[] = {"kernel", "region", "space", "device",
+            "tuning"};
+        return names[f];
+    }
+    static const char * event_name(int k) {
+        static const char * names[] = {"kernel", "fence", "deep copy",
+            "allocation"};
+        return names[k];
+    }
+    /* Labels are user strings, so double any quotes in them */
+    static std::string csv_quote(const std::string& str) {
+        std::string quoted("\"");
+        for (char c : str) {
+            if (c == '"') { quoted += c; }
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+    group_by() : _enabled(false) {
+        for (int f = 0 ; f < num_fields ; f++) { _fields[f] = false; }
+        std::string tmp(apex::apex_options::kokkos_group_by());
+        std::vector<std::string> names;
+        apex::split(tmp, ',', names);
+        for (std::string name : names) {
+            name.erase(std::remove(name.begin(), name.end(), ' '), name.end());
+            if (name.empty()) { continue; }
+            bool found = false;
+            for (int f = 0 ; f < num_fields ; f++) {
+                if (name.compare(field_name(f)) == 0) {
+                    if (!_fields[f]) { _order.push_back((field)f); }
+                    _fields[f] = found = true;
+                }
+            }
+            if (!found) {
+                std::cerr << "APEX: unknown APEX_KOKKOS_GROUP_BY attribute '"
+                          << name << "', ignoring" << std::endl;
+            }
+        }
+        _enabled = !_order.empty();
+    }
+    /* Find the entry for this event in this thread's table, dropping the
+     * attributes that aren't being grouped by.  Call with t.mtx held. */
+    entry * get(table& t, event_kind kind, const char * label,
+        const char * space, uint32_t devid) {
+        static const std::string empty_string;
+        const std::string * region = nullptr;
+        const std::string * tuning = nullptr;
+        uint64_t h = fnv1a_offset ^ kind;
+        if (!_fields[field_kernel]) { label = ""; }
+        h = fnv1a(label, h);
+        if (_fields[field_region]) {
+            region = &(region_path::instance().path());
+            h ^= region_path::instance().hash();
+            h *= fnv1a_prime;
+        }
+        if (!_fields[field_space]) { space = ""; }
+        h = fnv1a(space, h);
+        if (!_fields[field_device]) { devid = 0; }
+        h ^= devid;
+        h *= fnv1a_prime;
+        if (_fields[field_tuning]) {
+            tuning = &(apex_kokkos_tuning_context());
+            h = fnv1a(tuning->c_str(), h);
+        }
+        return t.find(h, kind, label, region, space, devid, tuning);
+    }
+public:
+    bool enabled(void) const { return _enabled; }
+    bool by_tuning(void) const { return _fields[field_tuning]; }
+    /* Timed events - kernels, fences and deep copies nest on the thread
+     * that begins them. */
+    void begin(event_kind kind, const char * label, const char * space,
+        uint32_t devid, uint64_t bytes = 0) {
+        table& t = my_table();
+        std::unique_lock<std::mutex> l(t.mtx);
+        entry * e = get(t, kind, label, space, devid);
+        e->bytes += bytes;
+        active_events().push_back(active_event{e,
+            std::chrono::steady_clock::now()});
+    }
+    void end(void) {
+        auto end = std::chrono::steady_clock::now();
+        auto& active = active_events();
+        if (active.empty()) { return; }
+        active_event& a = active.back();
+        {
+            table& t = my_table();
+            std::unique_lock<std::mutex> l(t.mtx);
+            a.e->count++;
+            a.e->nanoseconds += std::chrono::duration_cast<
+                std::chrono::nanoseconds>(end - a.start).count();
+        }
+        active.pop_back();
+    }
+    /* Instantaneous events */
+    void record(event_kind kind, const char * label, const char * space,
+        uint64_t bytes) {
+        table& t = my_table();
+        std::unique_lock<std::mutex> l(t.mtx);
+        entry * e = get(t, kind, label, space, 0);
+        e->count++;
+        e->bytes += bytes;
+    }
+    void report(void) {
+        typedef std::tuple<int, std::string, std::string, std::string,
+            uint32_t, std::string> key_type;
+        std::map<key_type, std::tuple<uint64_t, uint64_t, uint64_t> > merged;
+        {
+            std::unique_lock<std::mutex> l(_tables_mtx);
+            for (table * t : _tables) {
+                std::unique_lock<std::mutex> tl(t->mtx);
+                for (const entry& e : t->entries()) {
+                    auto& totals = merged[key_type(e.kind, e.label, e.region,
+                        e.space, e.device, e.tuning)];
+                    std::get<0>(totals) += e.count;
+                    std::get<1>(totals) += e.nanoseconds;
+                    std::get<2>(totals) += e.bytes;
+                }
+            }
+        }
+        if (merged.empty()) { return; }
+        std::stringstream csv;
+        csv << "\"event\"";
+        for (field f : _order) { csv << ",\"" << field_name(f) << "\""; }
+        csv << ",\"count\",\"seconds\",\"bytes\"" << std::endl;
+        std::vector<std::pair<double, std::string> > rows;
+        for (auto& it : merged) {
+            const key_type& k = it.first;
+            std::stringstream row;
+            std::stringstream label;
+            label << event_name(std::get<0>(k));
+            row << csv_quote(event_name(std::get<0>(k)));
+            for (field f : _order) {
+                switch (f) {
+                    case field_kernel:
+                        row << "," << csv_quote(std::get<1>(k));
+                        label << ", " << std::get<1>(k);
+                        break;
+                    case field_region:
+                        row << "," << csv_quote(std::get<2>(k));
+                        label << ", [" << std::get<2>(k) << "]";
+                        break;
+                    case field_space:
+                        row << "," << csv_quote(std::get<3>(k));
+                        if (!std::get<3>(k).empty()) {
+                            label << ", " << std::get<3>(k);
+                        }
+                        break;
+                    case field_device:
+                        row << "," << std::get<4>(k);
+                        label << ", Dev: " << std::get<4>(k);
+                        break;
+                    case field_tuning:
+                        row << "," << csv_quote(std::get<5>(k));
+                        label << ", " << std::get<5>(k);
+                        break;
+                    default:
+                        break;
+                }
+            }
+            double seconds = (double)(std::get<1>(it.second)) * 1.0e-9;
+            row << "," << std::get<0>(it.second) << "," << std::fixed
+                << std::setprecision(9) << seconds << ","
+                << std::get<2>(it.second);
+            csv << row.str() << std::endl;
+            std::stringstream line;
+            line << std::left << std::setw(64) << label.str().substr(0, 63)
+                 << std::right << std::setw(12) << std::get<0>(it.second)
+                 << std::setw(14) << std::fixed << std::setprecision(6)
+                 << seconds << std::setw(16) << std::get<2>(it.second);
+            rows.push_back(std::make_pair(seconds, line.str()));
+        }
+        std::ofstream csvfile;
+        std::stringstream csvname;
+        csvname << apex::apex_options::output_file_path();
+        csvname << apex::filesystem_separator() << "apex_kokkos_group_by."
+                << apex::apex::instance()->get_node_id() << ".csv";
+        csvfile.open(csvname.str(), std::ios::out);
+        csvfile << csv.str();
+        csvfile.close();
+        if (apex::apex_options::use_screen_output()) {
+            std::sort(rows.begin(), rows.end(),
+                [](const std::pair<double, std::string>& a,
+                   const std::pair<double, std::string>& b) {
+                    return a.first > b.first; });
+            std::cout << std::endl << "Kokkos events grouped by "
+                      << apex::apex_options::kokkos_group_by()
+                      << " (top " << std::min<size_t>(rows.size(), 20)
+                      << " of " << rows.size() << ", all in "
+                      << csvname.str() << "):" << std::endl;
+            std::cout << std::left << std::setw(64) << "group" << std::right
+                      << std::setw(12) << "count" << std::setw(14)
+                      << "seconds" << std::setw(16) << "bytes" << std::endl;
+            for (size_t i = 0 ; i < rows.size() && i < 20 ; i++) {
+                std::cout << rows[i].second << std::endl;
+            }
+        }
+    }
+    static group_by& instance() {
+        static group_by theinstance;
+        return theinstance;
+    }
+};
+
+bool apex_kokkos_group_by_tuning(void) {
+    return group_by::instance().by_tuning();
 }
-static std::unordered_map<uint32_t, apex::profiler*>& active_sections() {
-    static std::unordered_map<uint32_t, apex::profiler*> themap;
-    return themap;
+
+/* The region path is only maintained when something consumes it. */
+static bool track_region_path(void) {
+    return apex::apex_options::use_kokkos_callpath() ||
+        group_by::instance().enabled();
+}
+
+/* Kernel timers qualified by the region path they run in, when
+ * APEX_KOKKOS_CALLPATH is enabled.  The key is the incremental path hash
+ * mixed with the kernel's identifier, so a launch costs one hash combine
+ * and one lookup in a per-thread map - the qualified name is only built
+ * the first time a kernel runs under a given path.  Each entry remembers
+ * the path and kernel it was built for, and a hit is checked against
+ * them, so two pairs that hash alike can't share a timer.  Kernels
+ * launched outside of any region keep their plain timer. */
+class callpath_cache {
+private:
+    struct entry {
+        std::string path;
+        apex::task_identifier * id;
+        apex::task_identifier * qualified;
+        kernel_info * info;
+    };
+    static std::unordered_map<uint64_t, entry>& table() {
+        static APEX_NATIVE_TLS std::unordered_map<uint64_t, entry> * thetable
+            = nullptr;
+        if (thetable == nullptr) {
+            thetable = new std::unordered_map<uint64_t, entry>();
+        }
+        return *thetable;
+    }
+public:
+    /* Inside a region, info is replaced by the qualified timer's sampling
+     * state - nullptr if sampling is off or there's no room for it. */
+    static apex::task_identifier * get(apex::task_identifier * id,
+        kernel_info *& info) {
+        const region_path& path = region_path::instance();
+        if (path.path().empty()) { return id; }
+        uint64_t key = (path.hash() ^ (uint64_t)((uintptr_t)id)) *
+            fnv1a_prime;
+        entry& e = table()[key];
+        if (e.id != id || e.path != path.path()) {
+            // new, or a collision - the most recent pair keeps the slot
+            std::string name(id->get_name() + ", Region: " + path.path());
+            e.path = path.path();
+            e.id = id;
+            e.info = apex::apex_options::use_kokkos_sampling() ?
+                kernel_name_cache::instance().get_info(name) : nullptr;
+            e.qualified = e.info != nullptr ? e.info->id :
+                apex::task_identifier::get_task_id(name);
+        }
+        info = e.info;
+        return e.qualified;
+    }
+};
+
+/* Tool chaining.  Kokkos only loads one tool library, so APEX can stand in
+ * for a stack of them: every library listed in APEX_KOKKOS_CHILD_TOOLS is
+ * opened at init, and each of its hooks is resolved exactly once into a flat
+ * array of function pointers indexed by child.  Forwarding an event is then
+ * a loop over that array with no lookups, and the time spent inside each
+ * child is accumulated so its overhead can be reported at finalize.  Kokkos
+ * gives us one kernel id, fence handle and section id per event, so the
+ * children's values are kept on per-thread stacks (kernels and fences nest
+ * on the thread that launches them) and in a per-section slot.  The
+ * metadata and tuning hooks are forwarded too; the children see the
+ * tuning requests before APEX does, so with APEX_KOKKOS_TUNING on, the
+ * values APEX picks are the ones Kokkos gets. */
+class kokkos_tool_chain {
+public:
+    static constexpr size_t max_children = max_child_tools;
+    typedef void (*init_function)(const int, const uint64_t, const uint32_t,
+        KokkosPDeviceInfo*);
+    typedef void (*finalize_function)(void);
+    typedef void (*settings_function)(const uint32_t,
+        struct Kokkos_Tools_ToolSettings*);
+    typedef void (*begin_function)(const char*, const uint32_t, uint64_t*);
+    typedef void (*end_function)(uint64_t);
+    typedef void (*push_function)(const char*);
+    typedef void (*pop_function)(void);
+    typedef void (*data_function)(const SpaceHandle, const char*,
+        const void*, const uint64_t);
+    typedef void (*begin_copy_function)(SpaceHandle, const char*, const void*,
+        SpaceHandle, const char*, const void*, uint64_t);
+    typedef void (*end_copy_function)(void);
+    typedef void (*create_section_function)(const char*, uint32_t*);
+    typedef void (*section_function)(uint32_t);
+    typedef void (*event_function)(const char*);
+    typedef void (*metadata_function)(const char*, const char*);
+    typedef void (*declare_type_function)(const char*, const size_t,
+        Kokkos_Tools_VariableInfo*);
+    typedef void (*request_values_function)(const size_t, const size_t,
+        const Kokkos_Tools_VariableValue*, const size_t,
+        Kokkos_Tools_VariableValue*);
+    typedef void (*begin_context_function)(const size_t);
+    typedef void (*end_context_function)(const size_t,
+        Kokkos_Tools_VariableValue);
+    typedef void (*goal_function)(const size_t,
+        const Kokkos_Tools_OptimzationGoal);
+private:
+    size_t _count;
+    std::string _paths[max_children];
+    std::atomic<uint64_t> _calls[max_children];
+    std::atomic<uint64_t> _nanoseconds[max_children];
+    init_function _init[max_children];
+    finalize_function _finalize[max_children];
+    settings_function _settings[max_children];
+    begin_function _begin_for[max_children];
+    begin_function _begin_reduce[max_children];
+    begin_function _begin_scan[max_children];
+    end_function _end_for[max_children];
+    end_function _end_reduce[max_children];
+    end_function _end_scan[max_children];
+    push_function _push[max_children];
+    pop_function _pop[max_children];
+    data_function _allocate[max_children];
+    data_function _deallocate[max_children];
+    begin_copy_function _begin_copy[max_children];
+    end_copy_function _end_copy[max_children];
+    begin_function _begin_fence[max_children];
+    end_function _end_fence[max_children];
+    create_section_function _create_section[max_children];
+    section_function _start_section[max_children];
+    section_function _stop_section[max_children];
+    section_function _destroy_section[max_children];
+    event_function _event[max_children];
+    metadata_function _metadata[max_children];
+    declare_type_function _declare_output[max_children];
+    declare_type_function _declare_input[max_children];
+    request_values_function _request_values[max_children];
+    begin_context_function _begin_context[max_children];
+    end_context_function _end_context[max_children];
+    goal_function _declare_goal[max_children];
+    kokkos_tool_chain() : _count(0) {
+        for (size_t i = 0 ; i < max_children ; i++) {
+            _calls[i].store(0);
+            _nanoseconds[i].store(0);
+        }
+    }
+    template<typename T> static T resolve(void * handle, const char * name) {
+        return (T)((uintptr_t)dlsym(handle, name));
+    }
+    static std::vector<uint64_t>& handle_stack() {
+        static APEX_NATIVE_TLS std::vector<uint64_t> thestack;
+        return thestack;
+    }
+    void account(size_t i, std::chrono::steady_clock::time_point start) {
+        auto end = std::chrono::steady_clock::now();
+        _calls[i].fetch_add(1, std::memory_order_relaxed);
+        _nanoseconds[i].fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+            end - start).count(), std::memory_order_relaxed);
+    }
+    /* Call one hook in every child that defines it. */
+    template<typename F, typename... Args>
+    void dispatch(F * table, Args... args) {
+        for (size_t i = 0 ; i < _count ; i++) {
+            if (table[i] == nullptr) { continue; }
+            auto start = std::chrono::steady_clock::now();
+            table[i](args...);
+            account(i, start);
+        }
+    }
+    /* Begin hooks return a handle per child - push them in child order. */
+    void dispatch_begin(begin_function * table, const char * name,
+        uint32_t devid) {
+        auto& handles = handle_stack();
+        for (size_t i = 0 ; i < _count ; i++) {
+            uint64_t handle = 0;
+            if (table[i] != nullptr) {
+                auto start = std::chrono::steady_clock::now();
+                table[i](name, devid, &handle);
+                account(i, start);
+            }
+            handles.push_back(handle);
+        }
+    }
+    /* ...and pop them in reverse order at the matching end. */
+    void dispatch_end(end_function * table) {
+        auto& handles = handle_stack();
+        if (handles.size() < _count) { return; }
+        size_t base = handles.size() - _count;
+        for (size_t i = 0 ; i < _count ; i++) {
+            if (table[i] == nullptr) { continue; }
+            auto start = std::chrono::steady_clock::now();
+            table[i](handles[base + i]);
+            account(i, start);
+        }
+        handles.resize(base);
+    }
+public:
+    bool empty(void) const { return _count == 0; }
+    size_t size(void) const { return _count; }
+    /* Open and resolve the children.  Only called from
+     * kokkosp_init_library, before any other hook can arrive. */
+    void load(const char * paths) {
+        std::string tmp(paths);
+        if (tmp.empty()) { return; }
+        std::vector<std::string> libraries;
+        apex::split(tmp, ':', libraries);
+        for (const std::string & library : libraries) {
+            if (library.empty()) { continue; }
+            if (_count == max_children) {
+                std::cerr << "APEX: too many Kokkos child tools, ignoring "
+                          << library << std::endl;
+                continue;
+            }
+            const char * path = library.c_str();
+            void * handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+            if (!handle) {
+                std::cerr << "Error loading Kokkos child tool " << path
+                          << ": " << dlerror() << std::endl;
+                continue;
+            }
+            // chaining to ourselves would recurse forever
+            if (resolve<init_function>(handle, "kokkosp_init_library") ==
+                &kokkosp_init_library) {
+                std::cerr << "APEX: ignoring Kokkos child tool " << path
+                          << ", it is APEX" << std::endl;
+                dlclose(handle);
+                continue;
+            }
+            size_t i = _count;
+            _paths[i] = library;
+            _init[i] = resolve<init_function>(handle,
+                "kokkosp_init_library");
+            _finalize[i] = resolve<finalize_function>(handle,
+                "kokkosp_finalize_library");
+            _settings[i] = resolve<settings_function>(handle,
+                "kokkosp_request_tool_settings");
+            _begin_for[i] = resolve<begin_function>(handle,
+                "kokkosp_begin_parallel_for");
+            _begin_reduce[i] = resolve<begin_function>(handle,
+                "kokkosp_begin_parallel_reduce");
+            _begin_scan[i] = resolve<begin_function>(handle,
+                "kokkosp_begin_parallel_scan");
+            _end_for[i] = resolve<end_function>(handle,
+                "kokkosp_end_parallel_for");
+            _end_reduce[i] = resolve<end_function>(handle,
+                "kokkosp_end_parallel_reduce");
+            _end_scan[i] = resolve<end_function>(handle,
+                "kokkosp_end_parallel_scan");
+            _push[i] = resolve<push_function>(handle,
+                "kokkosp_push_profile_region");
+            _pop[i] = resolve<pop_function>(handle,
+                "kokkosp_pop_profile_region");
+            _allocate[i] = resolve<data_function>(handle,
+                "kokkosp_allocate_data");
+            _deallocate[i] = resolve<data_function>(handle,
+                "kokkosp_deallocate_data");
+            _begin_copy[i] = resolve<begin_copy_function>(handle,
+                "kokkosp_begin_deep_copy");
+            _end_copy[i] = resolve<end_copy_function>(handle,
+                "kokkosp_end_deep_copy");
+            _begin_fence[i] = resolve<begin_function>(handle,
+                "kokkosp_begin_fence");
+            _end_fence[i] = resolve<end_function>(handle,
+                "kokkosp_end_fence");
+            _create_section[i] = resolve<create_section_function>(handle,
+                "kokkosp_create_profile_section");
+            _start_section[i] = resolve<section_function>(handle,
+                "kokkosp_start_profile_section");
+            _stop_section[i] = resolve<section_function>(handle,
+                "kokkosp_stop_profile_section");
+            _destroy_section[i] = resolve<section_function>(handle,
+                "kokkosp_destroy_profile_section");
+            _event[i] = resolve<event_function>(handle,
+                "kokkosp_profile_event");
+            _metadata[i] = resolve<metadata_function>(handle,
+                "kokkosp_declare_metadata");
+            _declare_output[i] = resolve<declare_type_function>(handle,
+                "kokkosp_declare_output_type");
+            _declare_input[i] = resolve<declare_type_function>(handle,
+                "kokkosp_declare_input_type");
+            _request_values[i] = resolve<request_values_function>(handle,
+                "kokkosp_request_values");
+            _begin_context[i] = resolve<begin_context_function>(handle,
+                "kokkosp_begin_context");
+            _end_context[i] = resolve<end_context_function>(handle,
+                "kokkosp_end_context");
+            _declare_goal[i] = resolve<goal_function>(handle,
+                "kokkosp_declare_optimization_goal");
+            _count++;
+        }
+    }
+    void init(int loadseq, uint64_t version, uint32_t ndevinfos,
+        KokkosPDeviceInfo* devinfos) {
+        for (size_t i = 0 ; i < _count ; i++) {
+            if (_init[i] == nullptr) { continue; }
+            auto start = std::chrono::steady_clock::now();
+            _init[i](loadseq + 1 + (int)i, version, ndevinfos, devinfos);
+            account(i, start);
+        }
+    }
+    void finalize(void) { dispatch(_finalize); }
+    /* Any child that needs global fences gets them. */
+    bool request_settings(uint32_t num_actions,
+        struct Kokkos_Tools_ToolSettings * settings) {
+        bool fencing = false;
+        for (size_t i = 0 ; i < _count ; i++) {
+            if (_settings[i] == nullptr) { continue; }
+            struct Kokkos_Tools_ToolSettings mine = *settings;
+            mine.requires_global_fencing = false;
+            auto start = std::chrono::steady_clock::now();
+            _settings[i](num_actions, &mine);
+            account(i, start);
+            fencing = fencing || mine.requires_global_fencing;
+        }
+        return fencing;
+    }
+    void begin_kernel(kernel_kind kind, const char * name, uint32_t devid) {
+        dispatch_begin(kind == kernel_for ? _begin_for :
+            (kind == kernel_reduce ? _begin_reduce : _begin_scan),
+            name, devid);
+    }
+    void end_kernel(kernel_kind kind) {
+        dispatch_end(kind == kernel_for ? _end_for :
+            (kind == kernel_reduce ? _end_reduce : _end_scan));
+    }
+    void push_region(const char * name) { dispatch(_push, name); }
+    void pop_region(void) { dispatch(_pop); }
+    void allocate(SpaceHandle handle, const char * name, const void * ptr,
+        uint64_t size) {
+        dispatch(_allocate, handle, name, ptr, size);
+    }
+    void deallocate(SpaceHandle handle, const char * name, const void * ptr,
+        uint64_t size) {
+        dispatch(_deallocate, handle, name, ptr, size);
+    }
+    void begin_deep_copy(SpaceHandle dst_handle, const char * dst_name,
+        const void * dst_ptr, SpaceHandle src_handle, const char * src_name,
+        const void * src_ptr, uint64_t size) {
+        dispatch(_begin_copy, dst_handle, dst_name, dst_ptr,
+            src_handle, src_name, src_ptr, size);
+    }
+    void end_deep_copy(void) { dispatch(_end_copy); }
+    void begin_fence(const char * name, uint32_t devid) {
+        dispatch_begin(_begin_fence, name, devid);
+    }
+    void end_fence(void) { dispatch_end(_end_fence); }
+    /* Fill in the section ids the children hand back for this section. */
+    void create_section(const char * name, uint32_t * ids) {
+        for (size_t i = 0 ; i < _count ; i++) {
+            ids[i] = 0;
+            if (_create_section[i] == nullptr) { continue; }
+            auto start = std::chrono::steady_clock::now();
+            _create_section[i](name, &(ids[i]));
+            account(i, start);
+        }
+    }
+    void section(section_function * table, const uint32_t * ids) {
+        for (size_t i = 0 ; i < _count ; i++) {
+            if (table[i] == nullptr) { continue; }
+            auto start = std::chrono::steady_clock::now();
+            table[i](ids[i]);
+            account(i, start);
+        }
+    }
+    void start_section(const uint32_t * ids) { section(_start_section, ids); }
+    void stop_section(const uint32_t * ids) { section(_stop_section, ids); }
+    void destroy_section(const uint32_t * ids) {
+        section(_destroy_section, ids);
+    }
+    void profile_event(const char * name) { dispatch(_event, name); }
+    void declare_metadata(const char * key, const char * value) {
+        dispatch(_metadata, key, value);
+    }
+    void declare_output_type(const char * name, const size_t id,
+        Kokkos_Tools_VariableInfo * info) {
+        dispatch(_declare_output, name, id, info);
+    }
+    void declare_input_type(const char * name, const size_t id,
+        Kokkos_Tools_VariableInfo * info) {
+        dispatch(_declare_input, name, id, info);
+    }
+    void request_values(const size_t context_id, const size_t num_context,
+        const Kokkos_Tools_VariableValue * context_values,
+        const size_t num_tuning, Kokkos_Tools_VariableValue * tuning_values) {
+        dispatch(_request_values, context_id, num_context, context_values,
+            num_tuning, tuning_values);
+    }
+    void begin_context(const size_t context_id) {
+        dispatch(_begin_context, context_id);
+    }
+    void end_context(const size_t context_id,
+        Kokkos_Tools_VariableValue value) {
+        dispatch(_end_context, context_id, value);
+    }
+    void declare_optimization_goal(const size_t context_id,
+        const Kokkos_Tools_OptimzationGoal goal) {
+        dispatch(_declare_goal, context_id, goal);
+    }
+    /* Put the time spent in each child in the final profile, so the cost
+     * of stacking tools is visible next to the kernels themselves. */
+    void report(void) {
+        if (_count == 0) { return; }
+        std::stringstream screen;
+        screen << std::endl << "Kokkos child tool overhead:" << std::endl;
+        screen << std::left << std::setw(48) << "tool" << std::right
+               << std::setw(14) << "calls" << std::setw(14) << "seconds"
+               << std::setw(14) << "usec/call" << std::endl;
+        for (size_t i = 0 ; i < _count ; i++) {
+            uint64_t calls = _calls[i].load();
+            double seconds = (double)(_nanoseconds[i].load()) * 1.0e-9;
+            std::stringstream ss;
+            ss << "Kokkos child tool " << _paths[i] << ": Overhead Seconds";
+            apex::sample_value(ss.str(), seconds);
+            screen << std::left << std::setw(48) << _paths[i] << std::right
+                   << std::setw(14) << calls
+                   << std::setw(14) << std::fixed << std::setprecision(6)
+                   << seconds << std::setw(14) << std::setprecision(3)
+                   << (calls > 0 ? (seconds * 1.0e6) / calls : 0.0)
+                   << std::endl;
+        }
+        if (apex::apex_options::use_screen_output()) {
+            std::cout << screen.str();
+        }
+    }
+    static kokkos_tool_chain& instance() {
+        static kokkos_tool_chain chain;
+        return chain;
+    }
+};
+
+/* The tuning hooks live in apex_kokkos_tuning.cpp, and pass their events
+ * on to the child tools through these. */
+void apex_kokkos_chain_declare_output_type(const char* name, const size_t id,
+    Kokkos_Tools_VariableInfo* info) {
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.declare_output_type(name, id, info); }
+}
+
+void apex_kokkos_chain_declare_input_type(const char* name, const size_t id,
+    Kokkos_Tools_VariableInfo* info) {
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.declare_input_type(name, id, info); }
+}
+
+void apex_kokkos_chain_request_values(const size_t contextId,
+    const size_t numContextVariables,
+    const Kokkos_Tools_VariableValue* contextVariableValues,
+    const size_t numTuningVariables,
+    Kokkos_Tools_VariableValue* tuningVariableValues) {
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) {
+        chain.request_values(contextId, numContextVariables,
+            contextVariableValues, numTuningVariables, tuningVariableValues);
+    }
+}
+
+void apex_kokkos_chain_begin_context(const size_t contextId) {
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.begin_context(contextId); }
+}
+
+void apex_kokkos_chain_end_context(const size_t contextId,
+    Kokkos_Tools_VariableValue value) {
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.end_context(contextId, value); }
+}
+
+static apex::profiler * start_kernel(const char* name,
+    kernel_kind kind, uint32_t devid) {
+    kernel_info * info =
+        kernel_name_cache::instance().get_info(name, kind, devid);
+    apex::task_identifier * id = info != nullptr ? info->id :
+        kernel_name_cache::instance().get(name, kind, devid);
+    if (apex::apex_options::use_kokkos_callpath()) {
+        id = callpath_cache::get(id, info);
+    }
+    if (apex::apex_options::use_kokkos_deep_copy_analysis()) {
+        deep_copy_tracker::kernel_epoch()++;
+    }
+    fence_tracker::instance().launched(devid, id);
+    if (apex::apex_options::use_kokkos_instance_analysis()) {
+        instance_timeline::instance().begin_kernel(devid, id);
+    }
+    if (apex::apex_options::use_kokkos_sampling() && info != nullptr) {
+        // not sampled, end_kernel will see a null kernid
+        if (!kernel_sampler::instance().should_time(info)) {
+            return nullptr;
+        }
+        return kernel_sampler::instance().start(info, id);
+    }
+    // Start a new profiler, with no known parent
+    // (current timer on stack, if exists)
+    return apex::start(id);
+}
+
+static void end_kernel(uint64_t kernid) {
+    if (apex::apex_options::use_kokkos_instance_analysis()) {
+        instance_timeline::instance().end_kernel();
+    }
+    apex::profiler * p = (apex::profiler*)(kernid);
+    if (p == nullptr) { return; }
+    if (apex::apex_options::use_kokkos_sampling()) {
+        kernel_sampler::instance().stop(p);
+        return;
+    }
+    apex::stop(p);
 }
 
 extern "C" {
@@ -61,17 +2122,32 @@ extern "C" {
  */
 void kokkosp_init_library(int loadseq, uint64_t version,
     uint32_t ndevinfos, KokkosPDeviceInfo* devinfos) {
-    APEX_UNUSED(loadseq);
-    APEX_UNUSED(version);
-    APEX_UNUSED(ndevinfos);
-    APEX_UNUSED(devinfos);
     apex::init("APEX Kokkos handler", 0, 1);
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    chain.load(apex::apex_options::kokkos_child_tools());
+    chain.init(loadseq, version, ndevinfos, devinfos);
 }
 
 /* This function will be called only once, after all other calls to
  * profiling hooks.
  */
 void kokkosp_finalize_library() {
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) {
+        chain.finalize();
+        chain.report();
+    }
+    memory_tracker::instance().report();
+    deep_copy_tracker::instance().report();
+    if (apex::apex_options::use_kokkos_sampling()) {
+        kernel_sampler::instance().report();
+    }
+    if (apex::apex_options::use_kokkos_instance_analysis()) {
+        instance_timeline::instance().report();
+    }
+    if (group_by::instance().enabled()) {
+        group_by::instance().report();
+    }
     apex::finalize();
 }
 
@@ -80,6 +2156,11 @@ void kokkosp_request_tool_settings(int num_actions,
     struct Kokkos_Tools_ToolSettings *settings) {
     if ((num_actions > 0) && (settings != nullptr)) {
         settings->requires_global_fencing = apex::apex_options::use_kokkos_profiling_fences();
+        kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+        if (!chain.empty() &&
+            chain.request_settings((uint32_t)num_actions, settings)) {
+            settings->requires_global_fencing = true;
+        }
     }
 }
 
@@ -95,53 +2176,59 @@ void kokkosp_request_tool_settings(int num_actions,
  */
 void kokkosp_begin_parallel_for(const char* name,
     uint32_t devid, uint64_t* kernid) {
-    std::stringstream ss;
-    ss << "Kokkos for, Dev: " << devid << ", " << name;
-    std::string tmp{ss.str()};
-    // Start a new profiler, with no known parent
-    // (current timer on stack, if exists)
-    auto p = apex::start(tmp);
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.begin_kernel(kernel_for, name, devid); }
+    if (group_by::instance().enabled()) {
+        group_by::instance().begin(group_by::event_kernel, name, "", devid);
+    }
+    auto p = start_kernel(name, kernel_for, devid);
     // save the task wrapper in the kernid
     *(kernid) = (uint64_t)p;
 }
 
 void kokkosp_begin_parallel_reduce(const char* name,
     uint32_t devid, uint64_t* kernid) {
-    std::stringstream ss;
-    ss << "Kokkos reduce, Dev: " << devid << ", " << name;
-    std::string tmp{ss.str()};
-    // Start a new profiler, with no known parent
-    // (current timer on stack, if exists)
-    auto p = apex::start(tmp);
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.begin_kernel(kernel_reduce, name, devid); }
+    if (group_by::instance().enabled()) {
+        group_by::instance().begin(group_by::event_kernel, name, "", devid);
+    }
+    auto p = start_kernel(name, kernel_reduce, devid);
     // save the task wrapper in the kernid
     *(kernid) = (uint64_t)p;
 }
 
 void kokkosp_begin_parallel_scan(const char* name,
     uint32_t devid, uint64_t* kernid) {
-    std::stringstream ss;
-    ss << "Kokkos scan, Dev: " << devid << ", " << name;
-    std::string tmp{ss.str()};
-    // Start a new profiler, with no known parent
-    // (current timer on stack, if exists)
-    auto p = apex::start(tmp);
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.begin_kernel(kernel_scan, name, devid); }
+    if (group_by::instance().enabled()) {
+        group_by::instance().begin(group_by::event_kernel, name, "", devid);
+    }
+    auto p = start_kernel(name, kernel_scan, devid);
     // save the task wrapper in the kernid
     *(kernid) = (uint64_t)p;
 }
 
 void kokkosp_end_parallel_for(uint64_t kernid) {
-    apex::profiler * p = (apex::profiler*)(kernid);
-    apex::stop(p);
+    if (group_by::instance().enabled()) { group_by::instance().end(); }
+    end_kernel(kernid);
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.end_kernel(kernel_for); }
 }
 
 void kokkosp_end_parallel_reduce(uint64_t kernid) {
-    apex::profiler * p = (apex::profiler*)(kernid);
-    apex::stop(p);
+    if (group_by::instance().enabled()) { group_by::instance().end(); }
+    end_kernel(kernid);
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.end_kernel(kernel_reduce); }
 }
 
 void kokkosp_end_parallel_scan(uint64_t kernid) {
-    apex::profiler * p = (apex::profiler*)(kernid);
-    apex::stop(p);
+    if (group_by::instance().enabled()) { group_by::instance().end(); }
+    end_kernel(kernid);
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.end_kernel(kernel_scan); }
 }
 
 /* This function will be called by
@@ -157,6 +2244,9 @@ void kokkosp_end_parallel_scan(uint64_t kernid) {
  * user.
  */
 void kokkosp_push_profile_region(const char* name) {
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.push_region(name); }
+    if (track_region_path()) { region_path::instance().push(name); }
     std::stringstream ss;
     ss << "Kokkos region, " << name;
     std::string tmp{ss.str()};
@@ -176,6 +2266,9 @@ void kokkosp_pop_profile_region() {
         apex::stop(p);
         timer_stack().pop();
     }
+    if (track_region_path()) { region_path::instance().pop(); }
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.pop_region(); }
 }
 
 /* This function will be called whenever a shared allocation is created to
@@ -186,20 +2279,14 @@ void kokkosp_pop_profile_region() {
  */
 void kokkosp_allocate_data(SpaceHandle_t handle, const char* name,
     void* ptr, uint64_t size) {
-    APEX_UNUSED(ptr);
-    std::stringstream ss;
-    ss << "Kokkos " << handle.name << " data, " << name;
-    /*
-    std::string tmp{ss.str()};
-    auto p = apex::start(tmp);
-    memory_mtx.lock();
-    memory_map().insert(std::pair<void*,apex::profiler*>(ptr, p));
-    memory_mtx.unlock();
-    */
-    ss << ": Bytes";
-    std::string tmp2{ss.str()};
-    double bytes = (double)(size);
-    apex::sample_value(tmp2, bytes);
+    // also samples the allocation size, by identifier
+    memory_tracker::instance().allocate(handle.name, name, ptr, size);
+    if (group_by::instance().enabled()) {
+        group_by::instance().record(group_by::event_allocation, name,
+            handle.name, size);
+    }
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.allocate(handle, name, ptr, size); }
 }
 
 /* This function will be called whenever a shared allocation is destroyed. The
@@ -209,17 +2296,9 @@ void kokkosp_allocate_data(SpaceHandle_t handle, const char* name,
  */
 void kokkosp_deallocate_data(SpaceHandle handle, const char* name,
     void* ptr, uint64_t size) {
-    APEX_UNUSED(handle);
-    APEX_UNUSED(name);
-    APEX_UNUSED(ptr);
-    APEX_UNUSED(size);
-    /*
-    memory_mtx.lock();
-    auto p = memory_map()[ptr];
-    memory_map().erase(ptr);
-    memory_mtx.unlock();
-    apex::stop(p);
-    */
+    memory_tracker::instance().deallocate(ptr);
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.deallocate(handle, name, ptr, size); }
 }
 
 /* This function will be called whenever a Kokkos::deep_copy function is
@@ -234,6 +2313,11 @@ void kokkosp_begin_deep_copy(
     SpaceHandle dst_handle, const char* dst_name, const void* dst_ptr,
     SpaceHandle src_handle, const char* src_name, const void* src_ptr,
     uint64_t size) {
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) {
+        chain.begin_deep_copy(dst_handle, dst_name, dst_ptr,
+            src_handle, src_name, src_ptr, size);
+    }
     std::stringstream ss;
     ss << "Kokkos deep copy: " << src_handle.name << " " << src_name
        << " -> " << dst_handle.name << " " << dst_name;
@@ -244,17 +2328,62 @@ void kokkosp_begin_deep_copy(
     std::string tmp2{ss.str()};
     double bytes = (double)(size);
     apex::sample_value(tmp2, bytes);
-    APEX_UNUSED(src_ptr);
-    APEX_UNUSED(dst_ptr);
+    deep_copy_tracker::instance().begin(src_handle.name, src_ptr, src_name,
+        dst_handle.name, dst_ptr, dst_name, size);
+    if (apex::apex_options::use_kokkos_instance_analysis()) {
+        instance_timeline::instance().begin_deep_copy();
+    }
+    if (group_by::instance().enabled()) {
+        std::string label(std::string(src_name) + " -> " + dst_name);
+        std::string spaces(std::string(src_handle.name) + " -> " +
+            dst_handle.name);
+        group_by::instance().begin(group_by::event_deep_copy, label.c_str(),
+            spaces.c_str(), 0, size);
+    }
 }
 
 /* This function marks the end of a Kokkos::deep_copy call following a
  * kokkosp_begind_deep_copy call.
  */
 void kokkosp_end_deep_copy() {
+    if (group_by::instance().enabled()) { group_by::instance().end(); }
+    if (apex::apex_options::use_kokkos_instance_analysis()) {
+        instance_timeline::instance().end_deep_copy();
+    }
+    deep_copy_tracker::instance().end();
     auto p = timer_stack().top();
     apex::stop(p);
     timer_stack().pop();
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.end_deep_copy(); }
+}
+
+/* These functions are called before and after Kokkos fences an execution
+ * space or instance.  The name is the user (or Kokkos) provided reason for
+ * the fence, devid identifies the device and instance being fenced, and
+ * handle is an output variable that is passed to kokkosp_end_fence.
+ */
+void kokkosp_begin_fence(const char* name, const uint32_t devid,
+    uint64_t* handle) {
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.begin_fence(name, devid); }
+    *(handle) = fence_tracker::instance().begin(name, devid);
+    if (apex::apex_options::use_kokkos_instance_analysis()) {
+        instance_timeline::instance().begin_fence(name, devid);
+    }
+    if (group_by::instance().enabled()) {
+        group_by::instance().begin(group_by::event_fence, name, "", devid);
+    }
+}
+
+void kokkosp_end_fence(uint64_t handle) {
+    if (group_by::instance().enabled()) { group_by::instance().end(); }
+    if (apex::apex_options::use_kokkos_instance_analysis()) {
+        instance_timeline::instance().end_fence();
+    }
+    fence_tracker::instance().end(handle);
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.end_fence(); }
 }
 
 /* Create a profiling section handle. Sections can overlap with each other
@@ -265,11 +2394,10 @@ void kokkosp_end_deep_copy() {
  */
 void kokkosp_create_profile_section( const char* name,
     uint32_t* sec_id) {
-    std::string tmp{name};
-    section_mtx.lock();
-    *sec_id = (uint32_t)(sections().size());
-    sections().push_back(tmp);
-    section_mtx.unlock();
+    *sec_id = section_table::instance().create(name);
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    uint32_t * ids = section_table::instance().child_ids(*sec_id);
+    if (!chain.empty() && ids != nullptr) { chain.create_section(name, ids); }
 }
 
 /* Start a profiling section using a previously created section id. A
@@ -277,36 +2405,53 @@ void kokkosp_create_profile_section( const char* name,
  * stopped each time.
  */
 void kokkosp_start_profile_section( uint32_t sec_id) {
-    section_mtx.lock();
-    auto name = sections()[sec_id];
-    section_mtx.unlock();
-    auto p = apex::start(name);
-    section_mtx.lock();
-    active_sections().insert(std::pair<uint32_t, apex::profiler*>(sec_id, p));
-    section_mtx.unlock();
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    uint32_t * ids = section_table::instance().child_ids(sec_id);
+    if (!chain.empty() && ids != nullptr) { chain.start_section(ids); }
+    section_table::instance().start(sec_id);
 }
 
 /* Stop a profiling section using a previously created section id.
  */
 void kokkosp_stop_profile_section( uint32_t sec_id) {
-    section_mtx.lock();
-    auto p = active_sections()[sec_id];
-    section_mtx.unlock();
-    apex::stop(p);
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    uint32_t * ids = section_table::instance().child_ids(sec_id);
+    if (!chain.empty() && ids != nullptr) { chain.stop_section(ids); }
+    section_table::instance().stop(sec_id);
 }
 
 /* Destroy a previously created profiling section.
  */
 void kokkosp_destroy_profile_section( uint32_t sec_id) {
-    section_mtx.lock();
-    active_sections().erase(sec_id);
-    section_mtx.unlock();
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    uint32_t * ids = section_table::instance().child_ids(sec_id);
+    if (!chain.empty() && ids != nullptr) { chain.destroy_section(ids); }
+    section_table::instance().destroy(sec_id);
 }
 
 /* Marks an event during an application with a user provided name.
  */
 void kokkosp_profile_event( const char* name ) {
     apex::sample_value(name, 0.0);
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.profile_event(name); }
+}
+
+/* Key/value metadata about the run.  APEX doesn't use it, but a child
+ * tool might.
+ */
+void kokkosp_declare_metadata(const char* key, const char* value) {
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.declare_metadata(key, value); }
+}
+
+/* Whether a tuning context should be minimized or maximized.  APEX always
+ * minimizes, this is only for the child tools.
+ */
+void kokkosp_declare_optimization_goal(const size_t contextId,
+    const Kokkos_Tools_OptimzationGoal goal) {
+    kokkos_tool_chain& chain = kokkos_tool_chain::instance();
+    if (!chain.empty()) { chain.declare_optimization_goal(contextId, goal); }
 }
 
 } // extern "C"
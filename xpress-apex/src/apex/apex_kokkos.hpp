@@ -9,6 +9,7 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
 
 typedef struct KokkosPDeviceInfo {
   uint32_t deviceID;
@@ -20,3 +21,29 @@ typedef struct KokkosPDeviceInfo {
 typedef struct SpaceHandle {
   char name[64];
 } SpaceHandle_t;
+
+/* The Kokkos tuning context active on the calling thread - the context
+ * variable values and the tuning values chosen for them - or an empty
+ * string outside of any context. Maintained by the tuning hooks. */
+const std::string& apex_kokkos_tuning_context(void);
+
+/* Whether APEX_KOKKOS_GROUP_BY includes the tuning context, so the tuning
+ * hooks only maintain it when it will be used. */
+bool apex_kokkos_group_by_tuning(void);
+
+/* Pass the tuning hooks on to the tools in APEX_KOKKOS_CHILD_TOOLS. The
+ * hooks are in apex_kokkos_tuning.cpp, the tool chain in apex_kokkos.cpp. */
+struct Kokkos_Tools_VariableInfo;
+struct Kokkos_Tools_VariableValue;
+void apex_kokkos_chain_declare_output_type(const char* name, const size_t id,
+    Kokkos_Tools_VariableInfo* info);
+void apex_kokkos_chain_declare_input_type(const char* name, const size_t id,
+    Kokkos_Tools_VariableInfo* info);
+void apex_kokkos_chain_request_values(const size_t contextId,
+    const size_t numContextVariables,
+    const Kokkos_Tools_VariableValue* contextVariableValues,
+    const size_t numTuningVariables,
+    Kokkos_Tools_VariableValue* tuningVariableValues);
+void apex_kokkos_chain_begin_context(const size_t contextId);
+void apex_kokkos_chain_end_context(const size_t contextId,
+    Kokkos_Tools_VariableValue value);
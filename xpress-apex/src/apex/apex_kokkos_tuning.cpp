@@ -149,9 +149,11 @@ private:
         strategy(apex_ah_tuning_strategy::SIMULATED_ANNEALING),
         //strategy(apex_ah_tuning_strategy::NELDER_MEAD),
         verbose(false),
+        percentile(0.0),
         use_history(false),
         running(false){
             verbose = apex::apex_options::use_kokkos_verbose();
+            percentile = apex::apex_options::kokkos_tuning_percentile();
             // don't do this until the object is constructed!
     }
 public:
@@ -167,6 +169,8 @@ public:
         requests;
     std::unordered_map<std::string, std::vector<int>> var_ids;
     bool verbose;
+    // optimize this percentile of the kernel time, if set, not the mean
+    double percentile;
     bool use_history;
     bool running;
     std::map<size_t, Variable*> inputs;
@@ -497,6 +501,23 @@ size_t& getDepth() {
     return depth;
 }
 
+/* The contexts on this thread that have requested values and not ended
+ * yet, with their context and tuning values, innermost last. */
+std::vector<std::pair<size_t, std::string> >& getActiveContexts() {
+    static APEX_NATIVE_TLS std::vector<std::pair<size_t, std::string> > *
+        contexts = nullptr;
+    if (contexts == nullptr) {
+        contexts = new std::vector<std::pair<size_t, std::string> >();
+    }
+    return *contexts;
+}
+
+const std::string& apex_kokkos_tuning_context(void) {
+    static const std::string none;
+    auto& contexts = getActiveContexts();
+    return contexts.empty() ? none : contexts.back().second;
+}
+
 std::string hashContext(size_t numVars,
     const Kokkos_Tools_VariableValue* values,
     std::map<size_t, Variable*>& varmap) {
@@ -635,20 +656,35 @@ bool handle_start(const std::string & name, const size_t vars,
 
         // need this in the lambda
         bool verbose = session.verbose;
+        double percentile = session.percentile;
         // Create a metric
         std::function<double(void)> metric = [=]()->double{
-            apex_profile * profile = apex::get_profile(name);
-            if(profile == nullptr) {
+            // optimize the tail latency instead of the mean
+            if (percentile > 0.0) {
+                double result = apex::get_percentile(name, percentile);
+                if (result == 0.0) {
+                    std::cerr << "ERROR: no histogram for " << name
+                              << " (set APEX_TIMER_HISTOGRAMS)" << std::endl;
+                }
+                if(verbose) {
+                    std::cout << "querying p" << percentile << " time: "
+                              << result/1000000000.0 << "s" << std::endl;
+                }
+                return result;
+            }
+            // a consistent copy, without holding up the timers
+            apex_profile profile;
+            if(!apex::get_profile_snapshot(name, profile)) {
                 std::cerr << "ERROR: no profile for " << name << std::endl;
                 //abort();
                 return 0.0;
             }
-            if(profile->calls == 0.0) {
+            if(profile.calls == 0.0) {
                 std::cerr << "ERROR: calls = 0 for " << name << std::endl;
                 //abort();
                 return 0.0;
             }
-            double result = profile->accumulated/profile->calls;
+            double result = profile.accumulated/profile.calls;
             if(verbose) {
                 std::cout << "querying time per call: " << (double)(result)/1000000000.0 << "s" << std::endl;
             }
@@ -754,6 +790,7 @@ extern "C" {
  */
 void kokkosp_declare_output_type(const char* name, const size_t id,
     Kokkos_Tools_VariableInfo& info) {
+    apex_kokkos_chain_declare_output_type(name, id, &info);
     if (!apex::apex_options::use_kokkos_tuning()) { return; }
     // don't track memory in this function.
     apex::in_apex prevent_memory_tracking;
@@ -777,6 +814,7 @@ void kokkosp_declare_output_type(const char* name, const size_t id,
  */
 void kokkosp_declare_input_type(const char* name, const size_t id,
     Kokkos_Tools_VariableInfo& info) {
+    apex_kokkos_chain_declare_input_type(name, id, &info);
     if (!apex::apex_options::use_kokkos_tuning()) { return; }
     // don't track memory in this function.
     apex::in_apex prevent_memory_tracking;
@@ -816,6 +854,9 @@ void kokkosp_request_values(
     const Kokkos_Tools_VariableValue* contextVariableValues,
     const size_t numTuningVariables,
     Kokkos_Tools_VariableValue* tuningVariableValues) {
+    // the child tools go first, so APEX has the last word when tuning
+    apex_kokkos_chain_request_values(contextId, numContextVariables,
+        contextVariableValues, numTuningVariables, tuningVariableValues);
     if (!apex::apex_options::use_kokkos_tuning()) { return; }
     // don't track memory in this function.
     apex::in_apex prevent_memory_tracking;
@@ -848,6 +889,11 @@ void kokkosp_request_values(
                 std::pair<uint32_t, std::string>(contextId, name));
         }
     }
+    if (apex_kokkos_group_by_tuning()) {
+        getActiveContexts().push_back(std::make_pair(contextId, name +
+            " -> " + hashContext(numTuningVariables, tuningVariableValues,
+            session.outputs)));
+    }
     if (session.verbose) {
         std::cout << std::endl << std::string(getDepth(), ' ');
         printTuning(numTuningVariables, tuningVariableValues);
@@ -859,6 +905,7 @@ void kokkosp_request_values(
  * starting measurement.
  */
 void kokkosp_begin_context(size_t contextId) {
+    apex_kokkos_chain_begin_context(contextId);
     if (!apex::apex_options::use_kokkos_tuning()) { return; }
     // don't track memory in this function.
     apex::in_apex prevent_memory_tracking;
@@ -873,9 +920,12 @@ void kokkosp_begin_context(size_t contextId) {
 
 /* This simply says that the contextId in the argument is now over.
  * If you provided tuning values associated with that context, those
- * values can now be associated with a result.
+ * values can now be associated with a result.  APEX measures the result
+ * itself, the value is only passed on to the child tools.
  */
-void kokkosp_end_context(const size_t contextId) {
+void kokkosp_end_context(const size_t contextId,
+    const Kokkos_Tools_VariableValue value) {
+    apex_kokkos_chain_end_context(contextId, value);
     if (!apex::apex_options::use_kokkos_tuning()) { return; }
     // don't track memory in this function.
     apex::in_apex prevent_memory_tracking;
@@ -899,6 +949,13 @@ void kokkosp_end_context(const size_t contextId) {
         session.active_requests.erase(contextId);
     }
     session.context_starts.erase(contextId);
+    auto& contexts = getActiveContexts();
+    for (auto it = contexts.rbegin() ; it != contexts.rend() ; ++it) {
+        if (it->first == contextId) {
+            contexts.erase(std::next(it).base());
+            break;
+        }
+    }
 }
 
 } // extern "C"
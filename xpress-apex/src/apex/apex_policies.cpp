@@ -479,7 +479,10 @@ int apex_throughput_throttling_dhc_policy(apex_context const context) {
     static double previous_value = 0.0; // instead of resetting.
     //static int current_cap = tuning_session->min_threads +
         //((tuning_session->max_threads - tuning_session->min_threads) >> 1);
-    static int current_cap = thread_cap_tuning_session->max_threads - 2;
+    // with fewer than three cores, don't start below the minimum
+    static int current_cap = max<int>(
+        thread_cap_tuning_session->max_threads - 2,
+        thread_cap_tuning_session->min_threads);
     int low_neighbor = max<int>(current_cap - 2,
         thread_cap_tuning_session->min_threads);
     int high_neighbor = min<int>(current_cap + 2,
@@ -184,6 +184,23 @@ typedef enum _profile_type {
   APEX_COUNTER       /*!< This profile is a sampled counter */
 } apex_profile_type;
 
+/** Sub-buckets per power of two in a timer histogram */
+#define APEX_HISTOGRAM_SUB_BUCKETS 16
+/** Number of buckets in a timer histogram, enough for durations up to
+ *  2^47 nanoseconds (about 39 hours) */
+#define APEX_HISTOGRAM_BUCKETS (APEX_HISTOGRAM_SUB_BUCKETS * 44)
+
+/**
+ * A log-linear histogram of timer durations, in nanoseconds.  Durations
+ * below APEX_HISTOGRAM_SUB_BUCKETS have a bucket each.  Above that, each
+ * power of two is split into APEX_HISTOGRAM_SUB_BUCKETS equal buckets, so
+ * a bucket is never wider than 1/16th of the values in it.
+ */
+typedef struct _histogram
+{
+    uint64_t counts[APEX_HISTOGRAM_BUCKETS]; /*!< Calls in each bucket */
+} apex_histogram;
+
 /**
  * The profile object for a timer in APEX.
  */
@@ -203,6 +220,10 @@ typedef struct _profile
     size_t bytes_allocated; /*!< total bytes allocated in this task */
     size_t bytes_freed;     /*!< total bytes freed in this task */
     int times_reset;        /*!< How many times was this timer reset */
+    apex_histogram * histogram; /*!< Call durations, if APEX_TIMER_HISTOGRAMS
+                                     is set and this is a timer (otherwise
+                                     NULL).  Shared with the live profile,
+                                     even in a snapshot. */
 } apex_profile;
 
 /** Rather than use void pointers everywhere, be explicit about
@@ -266,6 +287,11 @@ inline unsigned int sc_nprocessors_onln()
     macro (APEX_SUSPEND, suspend, bool, false) \
     macro (APEX_PAPI_SUSPEND, papi_suspend, bool, false) \
     macro (APEX_PROCESS_ASYNC_STATE, process_async_state, bool, true) \
+    macro (APEX_THREAD_LOCAL_PROFILES, thread_local_profiles, bool, false) \
+    macro (APEX_CONSUMER_THREADS, consumer_threads, int, 0) \
+    macro (APEX_QUEUE_CAPACITY, queue_capacity, int, 4096) \
+    macro (APEX_TIMER_HISTOGRAMS, timer_histograms, bool, false) \
+    macro (APEX_THROTTLE_SAMPLE_PERIOD, throttle_sample_period, int, 0) \
     macro (APEX_UNTIED_TIMERS, untied_timers, bool, false) \
     macro (APEX_TAU, use_tau, bool, false) \
     macro (APEX_OTF2, use_otf2, bool, false) \
@@ -332,11 +358,18 @@ inline unsigned int sc_nprocessors_onln()
     macro (APEX_KOKKOS_VERBOSE, use_kokkos_verbose, bool, false) \
     macro (APEX_KOKKOS_TUNING, use_kokkos_tuning, bool, true) \
     macro (APEX_KOKKOS_PROFILING_FENCES, use_kokkos_profiling_fences, bool, false) \
+    macro (APEX_KOKKOS_DEEP_COPY_ANALYSIS, use_kokkos_deep_copy_analysis, bool, false) \
+    macro (APEX_KOKKOS_SAMPLING, use_kokkos_sampling, bool, false) \
+    macro (APEX_KOKKOS_INSTANCE_ANALYSIS, use_kokkos_instance_analysis, bool, false) \
+    macro (APEX_KOKKOS_CALLPATH, use_kokkos_callpath, bool, false) \
     macro (APEX_START_DELAY_SECONDS, start_delay_seconds, int, 0) \
     macro (APEX_MAX_DURATION_SECONDS, max_duration_seconds, int, 0) \
 
 #define FOREACH_APEX_FLOAT_OPTION(macro) \
     macro (APEX_SCATTERPLOT_FRACTION, scatterplot_fraction, double, 0.01) \
+    macro (APEX_KOKKOS_SAMPLING_OVERHEAD, kokkos_sampling_overhead, double, 1.0) \
+    macro (APEX_KOKKOS_TUNING_PERCENTILE, kokkos_tuning_percentile, double, 0.0) \
+    macro (APEX_THROTTLE_OVERHEAD, throttle_overhead, double, 0.0) \
 
 #define FOREACH_APEX_STRING_OPTION(macro) \
     macro (APEX_PAPI_METRICS, papi_metrics, char*, "") \
@@ -348,7 +381,11 @@ inline unsigned int sc_nprocessors_onln()
     macro (APEX_OTF2_ARCHIVE_NAME, otf2_archive_name, char*, \
         APEX_DEFAULT_OTF2_ARCHIVE_NAME) \
     macro (APEX_EVENT_FILTER_FILE, task_event_filter_file, char*, "") \
-    macro (APEX_KOKKOS_TUNING_CACHE, kokkos_tuning_cache, char*, "")
+    macro (APEX_KOKKOS_TUNING_CACHE, kokkos_tuning_cache, char*, "") \
+    macro (APEX_KOKKOS_CHILD_TOOLS, kokkos_child_tools, char*, "") \
+    macro (APEX_KOKKOS_GROUP_BY, kokkos_group_by, char*, "") \
+    macro (APEX_CLOCK, timer_clock, char*, "system") \
+    macro (APEX_QUEUE_FULL_POLICY, queue_full_policy, char*, "spill")
 
 // Do the clang check first
 #if defined(__APPLE__) || defined(__clang__)
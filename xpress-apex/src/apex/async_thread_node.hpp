@@ -70,6 +70,33 @@ namespace apex {
         }
     };
 
+    /* Kokkos execution space instances, decoded from the device id that
+     * Kokkos passes to the profiling hooks. */
+    class kokkos_thread_node {
+    public:
+        uint32_t _type;
+        uint32_t _device;
+        uint32_t _instance;
+        kokkos_thread_node(uint32_t type, uint32_t device, uint32_t instance) :
+            _type(type), _device(device), _instance(instance) { }
+        bool operator==(const kokkos_thread_node &rhs) const {
+            return (_type     == rhs._type &&
+                    _device   == rhs._device &&
+                    _instance == rhs._instance);
+        }
+        bool operator<(const kokkos_thread_node &rhs) const {
+            if (_type < rhs._type) {
+                return true;
+            } else if (_type == rhs._type && _device < rhs._device) {
+                return true;
+            } else if (_type == rhs._type && _device == rhs._device &&
+                _instance < rhs._instance) {
+                return true;
+            }
+            return false;
+        }
+    };
+
     class dummy_thread_node {
     public:
         uint32_t _device;
@@ -80,6 +80,11 @@ public:
   void on_recv(message_event_data &data) { APEX_UNUSED(data); };
   void set_node_id(int node_id, int node_count) { APEX_UNUSED(node_id);
     APEX_UNUSED(node_count); }
+  listener_event_mask subscriptions(void) {
+    return listen_mask(listen_start) | listen_mask(listen_stop) |
+      listen_mask(listen_yield) | listen_mask(listen_resume) |
+      listen_mask(listen_reset);
+  }
 
   bool _handler(void);
   std::stack<task_identifier>* get_event_stack(unsigned int tid);
@@ -14,7 +14,7 @@
 
 namespace apex {
 
-event_filter::event_filter() : have_filter(false) {
+event_filter::event_filter() : have_filter(false), _have_include(false) {
     try {
         std::ifstream cfg(apex_options::task_event_filter_file());
         if (!cfg.good()) {
@@ -24,6 +24,9 @@ event_filter::event_filter() : have_filter(false) {
         rapidjson::IStreamWrapper file_wrapper(cfg);
         configuration.ParseStream(file_wrapper);
         cfg.close();
+        compile("exclude", _exclude_patterns);
+        compile("include", _include_patterns);
+        _have_include = configuration.HasMember("include");
         have_filter = true;
     } catch (...) {
         // fail silently, nothing to do but use defaults
@@ -78,44 +81,38 @@ void handle_error(std::regex_error& e) {
     }
 }
 
+/* Compile the patterns once, when the file is read.  A pattern that
+ * doesn't compile is reported and skipped. */
+void event_filter::compile(const char * key,
+    std::vector<std::regex>& patterns) {
+    if (!configuration.HasMember(key)) { return; }
+    auto & filter = configuration[key];
+    for(auto itr = filter.Begin(); itr != filter.End(); ++itr) {
+        std::string needle(itr->GetString());
+        needle.erase(std::remove(needle.begin(),needle.end(),'\"'),needle.end());
+        try {
+            patterns.emplace_back(needle);
+        } catch (std::regex_error& e) {
+            std::cerr << "Error: '" << e.what() << "' in regular expression: "
+                      << needle << std::endl;
+            handle_error(e);
+        }
+    }
+}
+
 bool event_filter::_exclude(const std::string &name) {
     // check if this timer should be explicitly ignored
-    if (configuration.HasMember("exclude")) {
-        auto & exclude_filter = configuration["exclude"];
-        for(auto itr = exclude_filter.Begin(); itr != exclude_filter.End(); ++itr) {
-            std::string needle(itr->GetString());
-            needle.erase(std::remove(needle.begin(),needle.end(),'\"'),needle.end());
-            try {
-                std::regex re(needle);
-                std::string haystack(name);
-                if (std::regex_search(haystack, re)) {
-                    return true;
-                }
-            } catch (std::regex_error& e) {
-                std::cerr << "Error: '" << e.what() << "' in regular expression: "
-                          << needle << std::endl;
-                handle_error(e);
-            }
+    for (auto& re : _exclude_patterns) {
+        if (std::regex_search(name, re)) {
+            return true;
         }
-        // not found in the exclude filters
-        // ...but don't assume anything yet - check for include list
     }
-    // check if this timer should be implicitly ignored
-    if (configuration.HasMember("include")) {
-        auto & include_filter = configuration["include"];
-        for(auto itr = include_filter.Begin(); itr != include_filter.End(); ++itr) {
-            std::string needle(itr->GetString());
-            needle.erase(std::remove(needle.begin(),needle.end(),'\"'),needle.end());
-            try {
-                std::regex re(needle);
-                std::string haystack(name);
-                if (std::regex_search(haystack, re)) {
-                    return false;
-                }
-            } catch (std::regex_error& e) {
-                std::cerr << "Error: '" << e.what() << "' in regular expression: "
-                          << needle << std::endl;
-                handle_error(e);
+    // not found in the exclude filters
+    // ...but don't assume anything yet - check for include list
+    if (_have_include) {
+        for (auto& re : _include_patterns) {
+            if (std::regex_search(name, re)) {
+                return false;
             }
         }
         // not found in the whitelist
@@ -128,6 +125,18 @@ bool event_filter::exclude(const std::string &name) {
     return instance()._exclude(name);
 }
 
+bool event_filter::exclude(task_identifier * id) {
+    uint8_t state = id->filter_state.load(std::memory_order_relaxed);
+    if (state == task_identifier::filter_unknown) {
+        /* Two threads could both get here, but they will come to the
+         * same decision. */
+        state = instance()._exclude(id->get_name()) ?
+            task_identifier::filter_excluded : task_identifier::filter_included;
+        id->filter_state.store(state, std::memory_order_relaxed);
+    }
+    return state == task_identifier::filter_excluded;
+}
+
 event_filter& event_filter::instance(void) {
     static event_filter _instance;
     return _instance;
@@ -10,6 +10,9 @@
 
 #include "apex.hpp"
 #include "apex_options.hpp"
+#include "task_identifier.hpp"
+#include <regex>
+#include <vector>
 #include <rapidjson/document.h>
 #include <rapidjson/istreamwrapper.h>
 
@@ -18,6 +21,9 @@ namespace apex {
 class event_filter {
 public:
     static bool exclude(const std::string &name);
+    /* Same as above, but the decision is cached on the identifier, so
+     * the patterns are only matched once per identifier. */
+    static bool exclude(task_identifier * id);
     static event_filter& instance(void);
     bool have_filter;
 private:
@@ -29,8 +35,13 @@ private:
     event_filter(event_filter const&)    = delete;
     void operator=(event_filter const&)  = delete;
     bool _exclude(const std::string &name);
+    void compile(const char * key, std::vector<std::regex>& patterns);
     static event_filter * _instance;
     rapidjson::Document configuration;
+    /* the "exclude" and "include" patterns, compiled when the file is read */
+    std::vector<std::regex> _exclude_patterns;
+    std::vector<std::regex> _include_patterns;
+    bool _have_include;
 };
 
 }
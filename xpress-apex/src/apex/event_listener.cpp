@@ -50,13 +50,29 @@ sample_value_event_data::sample_value_event_data(int thread_id,
   this->event_type_ = APEX_SAMPLE_VALUE;
   this->is_counter = true;
   this->thread_id = thread_id;
+  this->owns_name = true;
   this->counter_name = new string(counter_name);
+  this->counter_id = nullptr;
+  this->counter_value = counter_value;
+  this->is_threaded = threaded;
+}
+
+sample_value_event_data::sample_value_event_data(int thread_id,
+    task_identifier * counter_id, double counter_value, bool threaded) {
+  this->event_type_ = APEX_SAMPLE_VALUE;
+  this->is_counter = true;
+  this->thread_id = thread_id;
+  this->owns_name = false;
+  this->counter_name = &(counter_id->name);
+  this->counter_id = counter_id;
   this->counter_value = counter_value;
   this->is_threaded = threaded;
 }
 
 sample_value_event_data::~sample_value_event_data() {
-  delete(counter_name);
+  if (owns_name) {
+    delete(counter_name);
+  }
 }
 
 custom_event_data::custom_event_data(apex_event_type event_type,
@@ -60,12 +60,17 @@ public:
 };
 
 class sample_value_event_data : public event_data {
+private:
+  bool owns_name;
 public:
   std::string * counter_name;
+  task_identifier * counter_id; // nullptr if only the name is known
   double counter_value;
   bool is_threaded;
   bool is_counter;
   sample_value_event_data(int thread_id, std::string counter_name, double counter_value, bool threaded);
+  // borrows the identifier's name, rather than copying it
+  sample_value_event_data(int thread_id, task_identifier * counter_id, double counter_value, bool threaded);
   ~sample_value_event_data();
 };
 
@@ -108,6 +113,32 @@ public:
   ~custom_event_data();
 };
 
+/* The frequent events a listener can subscribe to.  apex keeps a list of
+ * subscribers for each of them, so a start or stop only calls into the
+ * listeners that do something with it.  The rare events (startup, dump,
+ * shutdown, new thread...) still go to every listener. */
+enum listener_event {
+  listen_start = 0,
+  listen_stop,
+  listen_yield,
+  listen_resume,
+  listen_reset,
+  listen_task_complete,
+  listen_sample_value,
+  listen_custom_event,
+  listen_send,
+  listen_recv,
+  listen_event_count
+};
+
+typedef uint32_t listener_event_mask;
+
+inline listener_event_mask listen_mask(listener_event event) {
+  return 1u << event;
+}
+
+const listener_event_mask listen_all = (1u << listen_event_count) - 1;
+
 /* Abstract class for creating an Event Listener class */
 
 class event_listener
@@ -135,6 +166,8 @@ public:
   virtual void on_send(message_event_data &data) = 0;
   virtual void on_recv(message_event_data &data) = 0;
   virtual void set_node_id(int node_id, int node_count) = 0;
+  // the frequent events this listener handles, see listener_event
+  virtual listener_event_mask subscriptions(void) { return listen_all; }
 };
 
 }
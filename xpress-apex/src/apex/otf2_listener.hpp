@@ -241,6 +241,12 @@ namespace apex {
             { APEX_UNUSED(data); };
         void on_send(message_event_data &data);
         void on_recv(message_event_data &data);
+        listener_event_mask subscriptions(void) {
+            return listen_mask(listen_start) | listen_mask(listen_stop) |
+                listen_mask(listen_yield) | listen_mask(listen_resume) |
+                listen_mask(listen_sample_value) | listen_mask(listen_send) |
+                listen_mask(listen_recv);
+        }
         void on_async_event(async_thread_node &node,
             std::shared_ptr<profiler> &p);
         void on_async_metric(async_thread_node &node,
@@ -115,6 +115,10 @@ public:
     void on_recv(message_event_data &data);
     void set_node_id(int node_id, int node_count) { APEX_UNUSED(node_id);
         APEX_UNUSED(node_count); }
+    listener_event_mask subscriptions(void) {
+        return listen_all & ~(listen_mask(listen_reset) |
+            listen_mask(listen_task_complete));
+    }
 
     int register_policy(const apex_event_type & when,
                         std::function<int(apex_context const&)> f);
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2014-2021 Kevin Huck
+ * Copyright (c) 2014-2021 University of Oregon
+ *
+ * Distributed under the Boost Software License, Version 1.0. (See accompanying
+ * file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include "apex_types.h"
+
+namespace apex {
+
+/* Fixed size block pools for the objects created on every timer start and
+ * stop (task_wrapper and profiler objects, and their shared_ptr control
+ * blocks).  Each thread allocates from its own free list per size class, so
+ * the common case is a pointer pop with no lock and no malloc.  Objects are
+ * usually released by another thread (whoever processes the profiler
+ * queues), so a block freed by a thread that doesn't own it is pushed onto
+ * the owner's "remote" list, and the owner takes that whole list back when
+ * its own list runs dry.  Pools are never destroyed, because blocks can
+ * still come home after the owning thread has exited.  Instead, an exiting
+ * thread leaves its pools on a global list, free blocks and all, and new
+ * threads adopt them from there, so there are only ever as many pools as
+ * the most threads that were alive at once. */
+class block_pool {
+public:
+    static constexpr size_t class_bytes = 64;
+    static constexpr size_t num_classes = 8;
+    static constexpr size_t blocks_per_chunk = 64;
+private:
+    /* Every block starts with this header; the object follows it. The
+     * header is 16 bytes, which keeps the object 16 byte aligned. */
+    struct block {
+        block_pool * owner; // nullptr for oversize allocations
+        block * next;
+    };
+    block * _local;
+    std::atomic<block*> _remote;
+    size_t _class;
+    block_pool * _next_orphan;
+    explicit block_pool(size_t c) : _local(nullptr), _remote(nullptr),
+        _class(c), _next_orphan(nullptr) {}
+    static block_pool ** thread_pools(void) {
+        static APEX_NATIVE_TLS block_pool * pools[num_classes];
+        return pools;
+    }
+    /* Once this thread's pools are given up, it allocates unpooled */
+    static bool& thread_exiting(void) {
+        static APEX_NATIVE_TLS bool exiting = false;
+        return exiting;
+    }
+    static std::mutex& orphan_mtx(void) {
+        static std::mutex mtx;
+        return mtx;
+    }
+    static block_pool ** orphans(void) {
+        static block_pool * pools[num_classes];
+        return pools;
+    }
+    /* Gives this thread's pools to the orphan list when it exits */
+    struct thread_guard {
+        ~thread_guard(void) {
+            block_pool ** mine = thread_pools();
+            thread_exiting() = true;
+            std::unique_lock<std::mutex> l(orphan_mtx());
+            for (size_t c = 0 ; c < num_classes ; c++) {
+                if (mine[c] == nullptr) { continue; }
+                mine[c]->_next_orphan = orphans()[c];
+                orphans()[c] = mine[c];
+                mine[c] = nullptr;
+            }
+        }
+    };
+    static block_pool * adopt(size_t c) {
+        // thread_local rather than APEX_NATIVE_TLS, for the destructor
+        static thread_local thread_guard guard;
+        (void)(guard);
+        {
+            std::unique_lock<std::mutex> l(orphan_mtx());
+            block_pool * pool = orphans()[c];
+            if (pool != nullptr) {
+                orphans()[c] = pool->_next_orphan;
+                pool->_next_orphan = nullptr;
+                return pool;
+            }
+        }
+        return new block_pool(c);
+    }
+    void refill(void) {
+        // reclaim everything other threads have given back
+        _local = _remote.exchange(nullptr, std::memory_order_acquire);
+        if (_local != nullptr) { return; }
+        size_t bytes = sizeof(block) + ((_class + 1) * class_bytes);
+        char * chunk = static_cast<char*>(
+            ::operator new(bytes * blocks_per_chunk));
+        for (size_t i = 0 ; i < blocks_per_chunk ; i++) {
+            block * b = reinterpret_cast<block*>(chunk + (i * bytes));
+            b->owner = this;
+            b->next = _local;
+            _local = b;
+        }
+    }
+public:
+    static void * allocate(size_t bytes) {
+        size_t c = (bytes + class_bytes - 1) / class_bytes;
+        if (c == 0) { c = 1; }
+        if (c > num_classes || thread_exiting()) {
+            block * b = static_cast<block*>(
+                ::operator new(sizeof(block) + bytes));
+            b->owner = nullptr;
+            return b + 1;
+        }
+        block_pool *& pool = thread_pools()[c - 1];
+        if (pool == nullptr) { pool = adopt(c - 1); }
+        if (pool->_local == nullptr) { pool->refill(); }
+        block * b = pool->_local;
+        pool->_local = b->next;
+        return b + 1;
+    }
+    static void deallocate(void * ptr) {
+        if (ptr == nullptr) { return; }
+        block * b = static_cast<block*>(ptr) - 1;
+        block_pool * owner = b->owner;
+        if (owner == nullptr) {
+            ::operator delete(b);
+            return;
+        }
+        if (thread_pools()[owner->_class] == owner) {
+            b->next = owner->_local;
+            owner->_local = b;
+            return;
+        }
+        /* The owner only ever takes the whole list, so a plain push is
+         * safe from ABA. */
+        block * head = owner->_remote.load(std::memory_order_relaxed);
+        do {
+            b->next = head;
+        } while (!owner->_remote.compare_exchange_weak(head, b,
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+};
+
+/* Standard allocator interface over the block pools, for
+ * std::allocate_shared and the shared_ptr control blocks. */
+template <typename T>
+class pool_allocator {
+public:
+    typedef T value_type;
+    pool_allocator(void) noexcept {}
+    template <typename U>
+    pool_allocator(const pool_allocator<U>&) noexcept {}
+    T * allocate(size_t n) {
+        return static_cast<T*>(block_pool::allocate(n * sizeof(T)));
+    }
+    void deallocate(T * p, size_t) noexcept {
+        block_pool::deallocate(p);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const pool_allocator<T>&, const pool_allocator<U>&) {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const pool_allocator<T>&, const pool_allocator<U>&) {
+    return false;
+}
+
+} // namespace apex
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <sstream>
@@ -20,12 +21,59 @@
 
 namespace apex {
 
+/* The statistics for one timer or counter.  Updates are serialized by a
+ * sequence lock - the count is odd while one is in progress - so a
+ * reader can take a consistent snapshot() without ever blocking the
+ * thread doing the update.  Reading the apex_profile directly (through
+ * get_profile) can see a half-finished update. */
 class profile {
 private:
     apex_profile _profile;
+    std::atomic<uint32_t> _sequence;
+    void write_lock() {
+        uint32_t s = _sequence.load(std::memory_order_relaxed);
+        while ((s & 1) != 0 || !_sequence.compare_exchange_weak(s, s + 1,
+            std::memory_order_acquire, std::memory_order_relaxed)) {
+            s = _sequence.load(std::memory_order_relaxed);
+        }
+        // the update mustn't become visible before the count goes odd
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    void write_unlock() {
+        _sequence.fetch_add(1, std::memory_order_release);
+    }
+    void _increment(double increase, int num_metrics, double * papi_metrics,
+        bool yielded) {
+        _profile.accumulated += increase;
+        for (int i = 0 ; i < num_metrics ; i++) {
+            _profile.papi_metrics[i] += papi_metrics[i];
+        }
+#ifdef FULL_STATISTICS
+        _profile.sum_squares += (increase * increase);
+        // if not a fully completed task, don't modify these until it is done
+        _profile.minimum = _profile.minimum > increase ? increase : _profile.minimum;
+        _profile.maximum = _profile.maximum < increase ? increase : _profile.maximum;
+#endif
+        if (!yielded) {
+          _profile.calls = _profile.calls + 1.0;
+          if (_profile.histogram != nullptr) {
+              _profile.histogram->counts[histogram_bucket(increase)]++;
+          }
+        }
+    }
+    void make_histogram(double initial, bool yielded) {
+        _profile.histogram = nullptr;
+        if (_profile.type == APEX_TIMER && apex_options::timer_histograms()) {
+            _profile.histogram = new apex_histogram();
+            if (!yielded) {
+                _profile.histogram->counts[histogram_bucket(initial)] = 1;
+            }
+        }
+    }
 public:
     profile(double initial, int num_metrics, double * papi_metrics, bool
-        yielded = false, apex_profile_type type = APEX_TIMER) {
+        yielded = false, apex_profile_type type = APEX_TIMER) :
+        _sequence(0) {
         _profile.type = type;
         if (!yielded) {
             _profile.calls = 1.0;
@@ -46,10 +94,11 @@ public:
         _profile.frees = 0;
         _profile.bytes_allocated = 0;
         _profile.bytes_freed = 0;
+        make_histogram(initial, yielded);
     };
     profile(double initial, int num_metrics, double * papi_metrics, bool
         yielded, double allocations, double frees, double bytes_allocated,
-        double bytes_freed) {
+        double bytes_freed) : _sequence(0) {
         _profile.type = APEX_TIMER;
         if (!yielded) {
             _profile.calls = 1.0;
@@ -70,40 +119,141 @@ public:
         _profile.frees = frees;
         _profile.bytes_allocated = bytes_allocated;
         _profile.bytes_freed = bytes_freed;
+        make_histogram(initial, yielded);
     };
+    ~profile() {
+        delete _profile.histogram;
+    }
+    /* The histogram bucket for a duration in nanoseconds.  The first
+     * APEX_HISTOGRAM_SUB_BUCKETS are one nanosecond wide, then each power
+     * of two gets APEX_HISTOGRAM_SUB_BUCKETS buckets. */
+    static int histogram_bucket(double value) {
+        if (value < APEX_HISTOGRAM_SUB_BUCKETS) {
+            return value < 0.0 ? 0 : (int)value;
+        }
+        int exponent;
+        // value = mantissa * 2^exponent, with mantissa in [0.5, 1)
+        double mantissa = frexp(value, &exponent);
+        int bucket = (exponent - 4) * APEX_HISTOGRAM_SUB_BUCKETS +
+            (int)((mantissa * 2.0 - 1.0) * APEX_HISTOGRAM_SUB_BUCKETS);
+        return bucket < APEX_HISTOGRAM_BUCKETS ? bucket :
+            APEX_HISTOGRAM_BUCKETS - 1;
+    }
+    /* The midpoint of a histogram bucket, in nanoseconds */
+    static double histogram_value(int bucket) {
+        if (bucket < APEX_HISTOGRAM_SUB_BUCKETS) { return bucket; }
+        int exponent = bucket / APEX_HISTOGRAM_SUB_BUCKETS + 4;
+        double width = ldexp(1.0, exponent) / (2 * APEX_HISTOGRAM_SUB_BUCKETS);
+        int sub = bucket % APEX_HISTOGRAM_SUB_BUCKETS;
+        return ldexp(0.5, exponent) + (sub + 0.5) * width;
+    }
     void increment(double increase, int num_metrics, double * papi_metrics,
         bool yielded) {
-        _profile.accumulated += increase;
-        for (int i = 0 ; i < num_metrics ; i++) {
-            _profile.papi_metrics[i] += papi_metrics[i];
-        }
-#ifdef FULL_STATISTICS
-        _profile.sum_squares += (increase * increase);
-        // if not a fully completed task, don't modify these until it is done
-        _profile.minimum = _profile.minimum > increase ? increase : _profile.minimum;
-        _profile.maximum = _profile.maximum < increase ? increase : _profile.maximum;
-#endif
-        if (!yielded) {
-          _profile.calls = _profile.calls + 1.0;
-        }
+        write_lock();
+        _increment(increase, num_metrics, papi_metrics, yielded);
+        write_unlock();
     }
     void increment(double increase, int num_metrics, double * papi_metrics,
         double allocations, double frees, double bytes_allocated, double bytes_freed,
         bool yielded) {
-        increment(increase, num_metrics, papi_metrics, yielded);
+        write_lock();
+        _increment(increase, num_metrics, papi_metrics, yielded);
         _profile.allocations += allocations;
         _profile.frees += frees;
         _profile.bytes_allocated += bytes_allocated;
         _profile.bytes_freed += bytes_freed;
+        write_unlock();
+    }
+    /* Fold another profile for the same timer or counter into this one.
+     * The other profile mustn't be changing. */
+    void merge(profile& other, int num_metrics) {
+        write_lock();
+        _profile.calls += other._profile.calls;
+        _profile.accumulated += other._profile.accumulated;
+        for (int i = 0 ; i < num_metrics ; i++) {
+            _profile.papi_metrics[i] += other._profile.papi_metrics[i];
+        }
+#ifdef FULL_STATISTICS
+        _profile.sum_squares += other._profile.sum_squares;
+        _profile.minimum = _profile.minimum > other._profile.minimum ?
+            other._profile.minimum : _profile.minimum;
+        _profile.maximum = _profile.maximum < other._profile.maximum ?
+            other._profile.maximum : _profile.maximum;
+#endif
+        _profile.allocations += other._profile.allocations;
+        _profile.frees += other._profile.frees;
+        _profile.bytes_allocated += other._profile.bytes_allocated;
+        _profile.bytes_freed += other._profile.bytes_freed;
+        if (_profile.histogram != nullptr &&
+            other._profile.histogram != nullptr) {
+            for (int i = 0 ; i < APEX_HISTOGRAM_BUCKETS ; i++) {
+                _profile.histogram->counts[i] +=
+                    other._profile.histogram->counts[i];
+            }
+        }
+        write_unlock();
     }
     void reset() {
+        write_lock();
         _profile.calls = 0.0;
         _profile.accumulated = 0.0;
         _profile.sum_squares = 0.0;
         _profile.minimum = 0.0;
         _profile.maximum = 0.0;
         _profile.times_reset++;
+        if (_profile.histogram != nullptr) {
+            *(_profile.histogram) = apex_histogram();
+        }
+        write_unlock();
     };
+    /* Copy out the statistics as of the last complete update.  Retries
+     * (briefly) if an update is in progress, but never takes a lock. */
+    void snapshot(apex_profile& out) {
+        while (true) {
+            uint32_t before = _sequence.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                out = _profile;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (_sequence.load(std::memory_order_relaxed) == before) {
+                    return;
+                }
+            }
+        }
+    }
+    /* The duration (in nanoseconds) that this percent of the calls took
+     * at most, to within a histogram bucket.  Zero if there is no
+     * histogram, or no calls.  Like snapshot(), never takes a lock. */
+    double get_percentile(double percent) {
+        if (_profile.histogram == nullptr) { return 0.0; }
+        while (true) {
+            uint32_t before = _sequence.load(std::memory_order_acquire);
+            if ((before & 1) != 0) { continue; }
+            const uint64_t * counts = _profile.histogram->counts;
+            uint64_t total = 0;
+            for (int i = 0 ; i < APEX_HISTOGRAM_BUCKETS ; i++) {
+                total += counts[i];
+            }
+            double result = 0.0;
+            if (total > 0) {
+                // the rank of the call we want, counting from 1
+                uint64_t rank = (uint64_t)ceil(percent / 100.0 * total);
+                if (rank < 1) { rank = 1; }
+                if (rank > total) { rank = total; }
+                uint64_t seen = 0;
+                for (int i = 0 ; i < APEX_HISTOGRAM_BUCKETS ; i++) {
+                    seen += counts[i];
+                    if (seen >= rank) {
+                        result = histogram_value(i);
+                        break;
+                    }
+                }
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_sequence.load(std::memory_order_relaxed) == before) {
+                return result;
+            }
+        }
+    }
     double get_calls() { return _profile.calls; }
     double get_mean() {
         return (get_accumulated() / _profile.calls);
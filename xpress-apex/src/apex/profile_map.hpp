@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2014-2021 Kevin Huck
+ * Copyright (c) 2014-2021 University of Oregon
+ *
+ * Distributed under the Boost Software License, Version 1.0. (See accompanying
+ * file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include "profile.hpp"
+#include "task_identifier.hpp"
+
+namespace apex {
+
+/* The map of profiles, split into shards by task identifier so that
+ * threads updating different timers don't contend for one lock.
+ *
+ * Identifiers are interned per thread, so the same timer can have a
+ * task_identifier* on every thread.  In front of the shards is an
+ * insert-only index from those pointers to their profile, which
+ * lookup() reads without locking.  A profile lives until clear(), so
+ * once an identifier has been published the hot paths never lock.
+ *
+ * To look up or insert by value, lock just the identifier's shard (see
+ * shard_for), and publish() the identifier you came in with.  lock() and
+ * unlock() take every shard, so a std::unique_lock<profile_map> can
+ * guard a walk over the whole map - begin(), end(), size(), find() and
+ * operator[] don't lock anything. */
+class profile_map {
+public:
+    typedef std::unordered_map<task_identifier, profile*> map_type;
+    static constexpr size_t num_shards = 16;
+    static constexpr size_t index_size = 4096; // must be a power of two
+    class shard {
+    public:
+        std::mutex mtx;
+        map_type map;
+    };
+    class const_iterator {
+    public:
+        const_iterator() : _owner(nullptr), _shard(0) {}
+        const_iterator(const profile_map * owner, size_t s) :
+            _owner(owner), _shard(s) {
+            if (_shard < num_shards) {
+                _it = _owner->_shards[_shard].map.begin();
+                skip_empty();
+            }
+        }
+        const map_type::value_type& operator*() const { return *_it; }
+        const map_type::value_type* operator->() const { return &(*_it); }
+        const_iterator& operator++() {
+            ++_it;
+            skip_empty();
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator tmp(*this);
+            ++(*this);
+            return tmp;
+        }
+        bool operator==(const const_iterator& rhs) const {
+            return _shard == rhs._shard &&
+                (_shard == num_shards || _it == rhs._it);
+        }
+        bool operator!=(const const_iterator& rhs) const {
+            return !(*this == rhs);
+        }
+    private:
+        friend class profile_map;
+        // move to the next shard whenever we fall off the end of one
+        void skip_empty(void) {
+            while (_it == _owner->_shards[_shard].map.end()) {
+                if (++_shard == num_shards) { return; }
+                _it = _owner->_shards[_shard].map.begin();
+            }
+        }
+        const profile_map * _owner;
+        size_t _shard;
+        map_type::const_iterator _it;
+    };
+    profile_map() {
+        for (size_t i = 0 ; i < index_size ; i++) { _index[i] = nullptr; }
+    }
+    ~profile_map() { clear_index(); }
+    /* Lock-free.  Returns nullptr if this identifier isn't published. */
+    profile * lookup(const task_identifier * id) const {
+        const index_node * node =
+            _index[index_for(id)].load(std::memory_order_acquire);
+        while (node != nullptr) {
+            if (node->key == id) { return node->value; }
+            node = node->next;
+        }
+        return nullptr;
+    }
+    /* Call with the identifier's shard locked, after checking lookup(),
+     * so each identifier is only published once. */
+    void publish(const task_identifier * id, profile * value) {
+        index_node * node = new index_node(id, value);
+        std::atomic<index_node*>& bucket = _index[index_for(id)];
+        node->next = bucket.load(std::memory_order_relaxed);
+        while (!bucket.compare_exchange_weak(node->next, node,
+            std::memory_order_release, std::memory_order_relaxed)) { }
+    }
+    shard& shard_for(const task_identifier& id) {
+        return _shards[std::hash<task_identifier>()(id) % num_shards];
+    }
+    void lock(void) {
+        for (size_t i = 0 ; i < num_shards ; i++) { _shards[i].mtx.lock(); }
+    }
+    void unlock(void) {
+        for (size_t i = num_shards ; i > 0 ; i--) {
+            _shards[i-1].mtx.unlock();
+        }
+    }
+    const_iterator begin(void) const { return const_iterator(this, 0); }
+    const_iterator end(void) const {
+        return const_iterator(this, num_shards);
+    }
+    size_t size(void) const {
+        size_t total = 0;
+        for (size_t i = 0 ; i < num_shards ; i++) {
+            total += _shards[i].map.size();
+        }
+        return total;
+    }
+    const_iterator find(const task_identifier& id) const {
+        size_t s = std::hash<task_identifier>()(id) % num_shards;
+        map_type::const_iterator it = _shards[s].map.find(id);
+        if (it == _shards[s].map.end()) { return end(); }
+        const_iterator result(this, s);
+        result._it = it;
+        return result;
+    }
+    profile*& operator[](const task_identifier& id) {
+        return shard_for(id).map[id];
+    }
+    /* Call with every shard locked, and nobody using lookup() */
+    void clear(void) {
+        for (size_t i = 0 ; i < num_shards ; i++) { _shards[i].map.clear(); }
+        clear_index();
+    }
+private:
+    class index_node {
+    public:
+        index_node(const task_identifier * k, profile * v) :
+            key(k), value(v), next(nullptr) {}
+        const task_identifier * key;
+        profile * value;
+        index_node * next;
+    };
+    static size_t index_for(const task_identifier * id) {
+        uintptr_t addr = reinterpret_cast<uintptr_t>(id);
+        // they're heap allocated, so the low bits don't say much
+        return ((addr ^ (addr >> 12)) >> 4) & (index_size - 1);
+    }
+    void clear_index(void) {
+        for (size_t i = 0 ; i < index_size ; i++) {
+            index_node * node = _index[i].exchange(nullptr);
+            while (node != nullptr) {
+                index_node * next = node->next;
+                delete node;
+                node = next;
+            }
+        }
+    }
+    shard _shards[num_shards];
+    std::atomic<index_node*> _index[index_size];
+};
+
+}
@@ -22,6 +22,8 @@ class profiler;
 #include <chrono>
 #include <memory>
 #include "task_wrapper.hpp"
+#include "pool_allocator.hpp"
+#include "apex_clock.hpp"
 
 namespace apex {
 
@@ -43,8 +45,6 @@ class disabled_profiler_exception : public std::exception {
 #define APEX_THROTTLE_PERCALL 50000 // 50k cycles.
 #endif
 
-#define MYCLOCK std::chrono::system_clock
-
 class profiler {
 private:
     task_identifier * task_id; // for counters, timers
@@ -67,6 +67,8 @@ public:
     bool is_resume; // for yield or resume
     reset_type is_reset;
     bool stopped;
+    // the cost of starting this timer, if its overhead is being sampled
+    uint64_t overhead_ns;
     task_identifier * get_task_id(void) {
         return task_id;
     }
@@ -90,7 +92,7 @@ public:
         guid(task->guid),
         is_counter(false),
         is_resume(resume),
-        is_reset(reset), stopped(false) { task->prof = this; };
+        is_reset(reset), stopped(false), overhead_ns(0) { task->prof = this; };
     // this constructor is for resetting profile values
     profiler(task_identifier * id,
              bool resume = false,
@@ -108,12 +110,13 @@ public:
         guid(0),
         is_counter(false),
         is_resume(resume),
-        is_reset(reset), stopped(false) { };
+        is_reset(reset), stopped(false), overhead_ns(0) { };
     // this constructor is for counters
     profiler(task_identifier * id, double value_) :
         task_id(id),
         tt_ptr(nullptr),
         start_ns(now_ns()),
+        end_ns(start_ns),
 #if APEX_HAVE_PAPI
         papi_start_values{0,0,0,0,0,0,0,0},
         papi_stop_values{0,0,0,0,0,0,0,0},
@@ -121,9 +124,10 @@ public:
         allocations(0), frees(0), bytes_allocated(0), bytes_freed(0),
         value(value_),
         children_value(0.0),
+        guid(0),
         is_counter(true),
         is_resume(false),
-        is_reset(reset_type::NONE), stopped(true) { };
+        is_reset(reset_type::NONE), stopped(true), overhead_ns(0) { };
     //copy constructor
     profiler(const profiler& in) :
         task_id(in.task_id),
@@ -140,7 +144,8 @@ public:
         is_counter(in.is_counter),
         is_resume(in.is_resume), // for yield or resume
         is_reset(in.is_reset),
-        stopped(in.stopped)
+        stopped(in.stopped),
+        overhead_ns(in.overhead_ns)
     {
         //printf("COPY!\n"); fflush(stdout);
 #if APEX_HAVE_PAPI
@@ -151,6 +156,13 @@ public:
 #endif
     }
     ~profiler(void) { /* not much to do here. */ };
+    // profilers are created and destroyed for every timer, so pool them
+    static void * operator new(size_t bytes) {
+        return block_pool::allocate(bytes);
+    }
+    static void operator delete(void * ptr) {
+        block_pool::deallocate(ptr);
+    }
     // for "yield" support
     void set_start(uint64_t timestamp) {
         start_ns = timestamp;
@@ -207,14 +219,9 @@ public:
         return elapsed() - children_value;
     }
 
-    static uint64_t time_point_to_nanoseconds(std::chrono::time_point<MYCLOCK> tp) {
-        auto value = tp.time_since_epoch();
-        uint64_t duration =
-            std::chrono::duration_cast<std::chrono::nanoseconds>(value).count();
-        return duration;
-    }
+    // see apex_clock.hpp for the choice of clock (APEX_CLOCK)
     static uint64_t now_ns() {
-        return time_point_to_nanoseconds(MYCLOCK::now());
+        return apex_clock::now_ns();
     }
 
     static profiler* get_disabled_profiler(void) {
@@ -54,8 +54,14 @@
 #if defined(APEX_THROTTLE)
 #include "apex_cxx_shared_lock.hpp"
 apex::shared_mutex_type throttled_event_set_mutex;
-#define APEX_THROTTLE_CALLS 1000
 #endif
+#define APEX_THROTTLE_CALLS 1000
+// with APEX_THROTTLE_OVERHEAD, time APEX itself on one start in so many...
+#define APEX_OVERHEAD_SAMPLE_PERIOD 32
+// ...and don't trust the average until there are this many samples
+#define APEX_OVERHEAD_MIN_SAMPLES 16
+// a sample longer than this was descheduled, or woke a consumer thread
+#define APEX_OVERHEAD_MAX_SAMPLE_NS 50000
 
 #if APEX_HAVE_PAPI
 #include "papi.h"
@@ -77,6 +83,12 @@ const int num_non_worker_threads_registered = 1; // including the main thread
 
 #define APEX_MAIN "APEX MAIN"
 #define APEX_SYNCHRONOUS_PROCESSING 1
+/* Without a consumer thread, a worker processes the queues once it has
+ * this many records waiting (half a ring, so the rings don't overflow). */
+#define APEX_SYNCHRONOUS_BATCH_SIZE(q) ((q)->capacity() / 2)
+/* With a pool of consumer threads, an idle consumer helps drain another
+ * partition's queue once it has this many records waiting. */
+#define APEX_STEAL_THRESHOLD(q) ((q)->capacity() / 4)
 
 #include "tau_listener.hpp"
 #include "utils.hpp"
@@ -91,6 +103,7 @@ using namespace std;
 using namespace apex;
 
 APEX_NATIVE_TLS unsigned int my_tid = 0; // the current thread's TID in APEX
+APEX_NATIVE_TLS unsigned int overhead_countdown = 0; // starts until a sample
 
 namespace apex {
 
@@ -103,10 +116,12 @@ std::unordered_set<profile*> free_profiles;
 
     /* We do this in two stages, to make the common case fast. */
     profiler_queue_t * profiler_listener::_construct_thequeue() {
-        profiler_queue_t * _thequeue = new profiler_queue_t();
+        profiler_queue_t * _thequeue =
+            new profiler_queue_t(_queue_capacity);
         /* We are locking to make sure the vector is only updated by
          * one thread at a time. */
         std::unique_lock<std::mutex> queue_lock(queue_mtx);
+        _thequeue->index = allqueues.size();
         allqueues.push_back(_thequeue);
         return _thequeue;
     }
@@ -118,6 +133,21 @@ std::unordered_set<profile*> free_profiles;
         return _thequeue;
     }
 
+    /* We do this in two stages, to make the common case fast. */
+    thread_profiles_t * profiler_listener::_construct_thread_profiles() {
+        thread_profiles_t * _profiles = new thread_profiles_t();
+        std::unique_lock<std::mutex> queue_lock(queue_mtx);
+        allprofiles.push_back(_profiles);
+        _num_thread_profiles.store(allprofiles.size(), memory_order_release);
+        return _profiles;
+    }
+    /* this is a thread-local pointer to each worker thread's profiles. */
+    thread_profiles_t * profiler_listener::thread_profiles() {
+        static APEX_NATIVE_TLS thread_profiles_t * _profiles =
+            _construct_thread_profiles();
+        return _profiles;
+    }
+
     /* We do this in two stages, to make the common case fast. */
     dependency_queue_t * profiler_listener::_construct_dependency_queue() {
         dependency_queue_t * _thequeue = new dependency_queue_t();
@@ -144,9 +174,10 @@ std::unordered_set<profile*> free_profiles;
 
   double profiler_listener::get_non_idle_time() {
     double non_idle_time = 0.0;
+    merge_thread_profiles();
     /* Iterate over all timers and accumulate the time spent in them */
-    unordered_map<task_identifier, profile*>::const_iterator it2;
-    std::unique_lock<std::mutex> task_map_lock(_task_map_mutex);
+    profile_map::const_iterator it2;
+    std::unique_lock<profile_map> task_map_lock(task_map);
     for(it2 = task_map.begin(); it2 != task_map.end(); it2++) {
       profile * p = it2->second;
 #if defined(APEX_THROTTLE)
@@ -231,16 +262,40 @@ std::unordered_set<profile*> free_profiles;
         }
         return theprofile;
     }
-    std::unique_lock<std::mutex> task_map_lock(_task_map_mutex);
-    unordered_map<task_identifier, profile*>::const_iterator it = task_map.find(id);
-    if (it != task_map.end()) {
+    merge_thread_profiles();
+    profile_map::shard& s = task_map.shard_for(id);
+    std::unique_lock<std::mutex> task_map_lock(s.mtx);
+    auto it = s.map.find(id);
+    if (it != s.map.end()) {
       return (*it).second;
     }
     return nullptr;
   }
 
+  /* The same, for an interned identifier.  Once the identifier has been
+   * published this doesn't take any lock the aggregation path uses. */
+  profile * profiler_listener::get_profile(task_identifier * id) {
+    merge_thread_profiles();
+    profile * theprofile = task_map.lookup(id);
+    if (theprofile != nullptr) { return theprofile; }
+    {
+        profile_map::shard& s = task_map.shard_for(*id);
+        std::unique_lock<std::mutex> task_map_lock(s.mtx);
+        auto it = s.map.find(*id);
+        if (it != s.map.end()) {
+            if (task_map.lookup(id) == nullptr) {
+                task_map.publish(id, it->second);
+            }
+            return it->second;
+        }
+    }
+    // the idle rate and time aren't in the map, they're made up on the spot
+    return get_profile(*id);
+  }
+
   void profiler_listener::reset_all(void) {
-    std::unique_lock<std::mutex> task_map_lock(_task_map_mutex);
+    merge_thread_profiles();
+    std::unique_lock<profile_map> task_map_lock(task_map);
     for(auto &it : task_map) {
         it.second->reset();
     }
@@ -263,6 +318,13 @@ std::unordered_set<profile*> free_profiles;
   }
 
   unsigned int profiler_listener::process_profile(profiler& p, unsigned int tid)
+  {
+    profiler_record r(p);
+    return process_profile(r,tid);
+  }
+
+  unsigned int profiler_listener::process_profile(profiler_record& p,
+    unsigned int tid)
   {
     APEX_UNUSED(tid);
     profile * theprofile;
@@ -270,25 +332,39 @@ std::unordered_set<profile*> free_profiles;
         reset_all();
         return 0;
     }
+    if(p.is_reset == reset_type::CURRENT) {
+        // don't let unmerged values outlive the reset
+        merge_thread_profiles();
+    }
     double values[8] = {0};
     double tmp_num_counters = 0;
 #if APEX_HAVE_PAPI
     tmp_num_counters = num_papi_counters;
     for (int i = 0 ; i < num_papi_counters ; i++) {
-        if (p.papi_stop_values[i] > p.papi_start_values[i]) {
-            values[i] = p.papi_stop_values[i] - p.papi_start_values[i];
-        } else {
-            values[i] = 0.0;
-        }
+        values[i] = p.papi_values[i];
     }
 #endif
-    std::unique_lock<std::mutex> task_map_lock(_task_map_mutex);
-    unordered_map<task_identifier, profile*>::const_iterator it =
-        task_map.find(*(p.get_task_id()));
-    if (it != task_map.end()) {
+    // Nothing is locked to find a profile this thread's identifier has
+    // been seen with before.  The profile's own sequence lock serializes
+    // updates from other consumers.
+    theprofile = task_map.lookup(p.get_task_id());
+    std::unique_lock<std::mutex> task_map_lock;
+    if (theprofile == nullptr) {
+        // the first time for this identifier, so look it up by value
+        profile_map::shard& s = task_map.shard_for(*(p.get_task_id()));
+        task_map_lock = std::unique_lock<std::mutex>(s.mtx);
+        theprofile = task_map.lookup(p.get_task_id());
+        if (theprofile == nullptr) {
+            auto it = s.map.find(*(p.get_task_id()));
+            if (it != s.map.end()) {
+                theprofile = (*it).second;
+                task_map.publish(p.get_task_id(), theprofile);
+            }
+        }
+    }
+    if (theprofile != nullptr) {
           // A profile for this ID already exists.
-        theprofile = (*it).second;
-        task_map_lock.unlock();
+        if (task_map_lock.owns_lock()) { task_map_lock.unlock(); }
         if(p.is_reset == reset_type::CURRENT) {
             theprofile->reset();
         } else {
@@ -301,38 +377,7 @@ std::unordered_set<profile*> free_profiles;
                     values, p.is_resume);
             }
         }
-#if defined(APEX_THROTTLE)
-        if (!apex_options::use_tau()) {
-          // Is this a lightweight task? If so, we shouldn't measure it any more,
-          // in order to reduce overhead.
-          if (theprofile->get_calls() > APEX_THROTTLE_CALLS &&
-              theprofile->get_mean() < APEX_THROTTLE_PERCALL) {
-              unordered_set<task_identifier>::const_iterator it2;
-              {
-                  read_lock_type l(throttled_event_set_mutex);
-                it2 = throttled_tasks.find(*(p.get_task_id()));
-              }
-              if (it2 == throttled_tasks.end()) {
-                  // lock the set for insert
-                  {
-                        write_lock_type l(throttled_event_set_mutex);
-                      // was it inserted when we were waiting?
-                      it2 = throttled_tasks.find(*(p.get_task_id()));
-                      // no? OK - insert it.
-                      if (it2 == throttled_tasks.end()) {
-                          throttled_tasks.insert(*(p.get_task_id()));
-                      }
-                  }
-                  if (apex_options::use_verbose()) {
-                      cout << "APEX: disabling lightweight timer "
-                           << p.get_task_id()->get_name()
-                            << endl;
-                      fflush(stdout);
-                  }
-              }
-          }
-        }
-#endif
+        throttle_check(p.get_task_id(), theprofile);
       } else {
         // Create a new profile for this name.
         if (apex_options::track_memory() && !p.is_counter) {
@@ -341,14 +386,14 @@ std::unordered_set<profile*> free_profiles;
                 tmp_num_counters, values, p.is_resume,
                 p.allocations, p.frees, p.bytes_allocated,
                 p.bytes_freed);
-            task_map[*(p.get_task_id())] = theprofile;
         } else {
             theprofile = new profile(p.is_reset ==
                 reset_type::CURRENT ? 0.0 : p.elapsed(),
                 tmp_num_counters, values, p.is_resume,
                 p.is_counter ? APEX_COUNTER : APEX_TIMER);
-            task_map[*(p.get_task_id())] = theprofile;
         }
+        task_map[*(p.get_task_id())] = theprofile;
+        task_map.publish(p.get_task_id(), theprofile);
         task_map_lock.unlock();
 #ifdef APEX_HAVE_HPX
 #ifdef APEX_REGISTER_HPX3_COUNTERS
@@ -375,43 +420,186 @@ std::unordered_set<profile*> free_profiles;
 #endif
 #endif
       }
-      /* write the sample to the file */
-      if (apex_options::task_scatterplot()) {
-        if (!p.is_counter) {
-            static int thresh = std::round((double)(RAND_MAX) * apex_options::scatterplot_fraction());
-            if (std::rand() < thresh) {
-                /* before calling p.get_task_id()->get_name(), make sure we create
-                 * a thread_instance object that is NOT a worker. */
-                thread_instance::instance(false);
-                std::unique_lock<std::mutex> task_map_lock(_mtx);
-                task_scatterplot_samples << p.normalized_timestamp() << " "
-                            << p.elapsed() << " "
-                            << "'" << p.get_task_id()->get_name() << "'" << endl;
-                int loc0 = task_scatterplot_samples.tellp();
-                if (loc0 > 32768) {
-                    task_scatterplot_sample_file() << task_scatterplot_samples.rdbuf();
-                    // reset the stringstream
-                    task_scatterplot_samples.str("");
-                }
-            }
-        } else {
-                thread_instance::instance(false);
-                std::unique_lock<std::mutex> task_map_lock(_mtx);
-                counter_scatterplot_samples << p.normalized_timestamp() << " "
-                            << p.elapsed() << " "
-                            << "'" << p.get_task_id()->get_name() << "'" << endl;
-                int loc0 = task_scatterplot_samples.tellp();
-                if (loc0 > 32768) {
-                    counter_scatterplot_sample_file() << counter_scatterplot_samples.rdbuf();
-                    // reset the stringstream
-                    counter_scatterplot_samples.str("");
-                }
-	}
+    record_sample(p);
+    return 1;
+  }
+
+  /* Is this a lightweight task? If so, we shouldn't measure it any more,
+   * in order to reduce overhead. */
+  void profiler_listener::throttle_check(task_identifier * id,
+    profile * theprofile) {
+#if defined(APEX_THROTTLE)
+    if (!apex_options::use_tau()) {
+      if (theprofile->get_calls() > APEX_THROTTLE_CALLS &&
+          theprofile->get_mean() < APEX_THROTTLE_PERCALL) {
+          unordered_set<task_identifier>::const_iterator it2;
+          {
+              read_lock_type l(throttled_event_set_mutex);
+            it2 = throttled_tasks.find(*id);
+          }
+          if (it2 == throttled_tasks.end()) {
+              // lock the set for insert
+              {
+                    write_lock_type l(throttled_event_set_mutex);
+                  // was it inserted when we were waiting?
+                  it2 = throttled_tasks.find(*id);
+                  // no? OK - insert it.
+                  if (it2 == throttled_tasks.end()) {
+                      throttled_tasks.insert(*id);
+                  }
+              }
+              if (apex_options::use_verbose()) {
+                  cout << "APEX: disabling lightweight timer "
+                       << id->get_name()
+                        << endl;
+                  fflush(stdout);
+              }
+          }
       }
-    if (apex_options::use_tasktree_output() && !p.is_counter && p.tt_ptr != nullptr) {
-        p.tt_ptr->tree_node->addAccumulated(p.elapsed_seconds(), p.is_resume);
     }
-    return 1;
+#endif
+    /* With APEX_THROTTLE_OVERHEAD, throttle any timer where APEX costs
+     * more than that percentage of the timer's mean duration. */
+    if (_throttle_overhead <= 0.0 || theprofile->get_type() != APEX_TIMER ||
+        id->throttled.load(memory_order_relaxed)) {
+        return;
+    }
+    uint64_t samples = id->overhead_samples.load(memory_order_relaxed);
+    if (samples < APEX_OVERHEAD_MIN_SAMPLES ||
+        theprofile->get_calls() < APEX_THROTTLE_CALLS) {
+        return;
+    }
+    double overhead =
+        (double)(id->overhead_ns.load(memory_order_relaxed)) / samples;
+    double mean = theprofile->get_mean();
+    if (overhead * 100.0 < mean * _throttle_overhead) { return; }
+    // another thread may be processing the same identifier
+    if (id->throttled.exchange(true, memory_order_relaxed)) { return; }
+    {
+        std::unique_lock<std::mutex> l(_throttle_mtx);
+        throttled_ids.push_back(id);
+    }
+    if (apex_options::use_verbose()) {
+        cout << "APEX: throttling timer " << id->get_name() << " ("
+             << overhead << " ns overhead, " << mean << " ns mean)" << endl;
+        fflush(stdout);
+    }
+  }
+
+  /* Write the scatterplot sample and update the task tree, if enabled */
+  void profiler_listener::record_sample(profiler_record& p) {
+    /* write the sample to the file */
+    if (apex_options::task_scatterplot()) {
+      if (!p.is_counter) {
+          static int thresh = std::round((double)(RAND_MAX) * apex_options::scatterplot_fraction());
+          if (std::rand() < thresh) {
+              /* before calling p.get_task_id()->get_name(), make sure we create
+               * a thread_instance object that is NOT a worker. */
+              thread_instance::instance(false);
+              std::unique_lock<std::mutex> task_map_lock(_mtx);
+              task_scatterplot_samples << p.normalized_timestamp() << " "
+                          << p.elapsed() << " "
+                          << "'" << p.get_task_id()->get_name() << "'" << endl;
+              int loc0 = task_scatterplot_samples.tellp();
+              if (loc0 > 32768) {
+                  task_scatterplot_sample_file() << task_scatterplot_samples.rdbuf();
+                  // reset the stringstream
+                  task_scatterplot_samples.str("");
+              }
+          }
+      } else {
+              thread_instance::instance(false);
+              std::unique_lock<std::mutex> task_map_lock(_mtx);
+              counter_scatterplot_samples << p.normalized_timestamp() << " "
+                          << p.elapsed() << " "
+                          << "'" << p.get_task_id()->get_name() << "'" << endl;
+              int loc0 = task_scatterplot_samples.tellp();
+              if (loc0 > 32768) {
+                  counter_scatterplot_sample_file() << counter_scatterplot_samples.rdbuf();
+                  // reset the stringstream
+                  counter_scatterplot_samples.str("");
+              }
+      }
+    }
+    if (apex_options::use_tasktree_output() && !p.is_counter && p.tree_node != nullptr) {
+        p.tree_node->addAccumulated(p.elapsed_seconds(), p.is_resume);
+    }
+  }
+
+  /* With APEX_THREAD_LOCAL_PROFILES, a stopped timer updates this thread's
+   * own profile directly - no queue, and no consumer. */
+  void profiler_listener::process_profile_locally(profiler_record& p) {
+    double values[8] = {0};
+    double tmp_num_counters = 0;
+#if APEX_HAVE_PAPI
+    tmp_num_counters = num_papi_counters;
+    for (int i = 0 ; i < num_papi_counters ; i++) {
+        values[i] = p.papi_values[i];
+    }
+#endif
+    thread_profiles_t * mine = thread_profiles();
+    profile * theprofile;
+    std::unique_lock<std::mutex> profiles_lock(mine->mtx);
+    auto it = mine->profiles.find(p.get_task_id());
+    if (it != mine->profiles.end()) {
+        theprofile = it->second;
+        if (apex_options::track_memory()) {
+            theprofile->increment(p.elapsed(), tmp_num_counters,
+                values, p.allocations, p.frees, p.bytes_allocated,
+                p.bytes_freed, p.is_resume);
+        } else {
+            theprofile->increment(p.elapsed(), tmp_num_counters,
+                values, p.is_resume);
+        }
+    } else {
+        if (apex_options::track_memory() && !p.is_counter) {
+            theprofile = new profile(p.elapsed(), tmp_num_counters, values,
+                p.is_resume, p.allocations, p.frees, p.bytes_allocated,
+                p.bytes_freed);
+        } else {
+            theprofile = new profile(p.elapsed(), tmp_num_counters, values,
+                p.is_resume, p.is_counter ? APEX_COUNTER : APEX_TIMER);
+        }
+        mine->profiles[p.get_task_id()] = theprofile;
+    }
+    // only this thread's calls, but that's enough to spot a tiny timer
+    throttle_check(p.get_task_id(), theprofile);
+    profiles_lock.unlock();
+    record_sample(p);
+  }
+
+  /* Fold every thread's profiles into the task_map, and empty them.  The
+   * first profile seen for a timer is moved rather than copied. */
+  void profiler_listener::merge_thread_profiles(void) {
+    // without thread-local profiles, there is nothing to merge - and no
+    // reason for get_profile to take queue_mtx
+    if (_num_thread_profiles.load(memory_order_acquire) == 0) { return; }
+    int tmp_num_counters = 0;
+#if APEX_HAVE_PAPI
+    tmp_num_counters = num_papi_counters;
+#endif
+    // a new thread's push_back can move the vector, so copy it out
+    std::vector<thread_profiles_t*> tables;
+    {
+        std::unique_lock<std::mutex> queue_lock(queue_mtx);
+        tables.assign(allprofiles.begin(), allprofiles.end());
+    }
+    for (thread_profiles_t * table : tables) {
+        std::unique_lock<std::mutex> profiles_lock(table->mtx);
+        if (table->profiles.empty()) { continue; }
+        for (auto &kv : table->profiles) {
+            profile_map::shard& s = task_map.shard_for(*(kv.first));
+            std::unique_lock<std::mutex> task_map_lock(s.mtx);
+            auto it = s.map.find(*(kv.first));
+            if (it != s.map.end()) {
+                it->second->merge(*(kv.second), tmp_num_counters);
+                delete kv.second;
+            } else {
+                s.map[*(kv.first)] = kv.second;
+            }
+        }
+        table->profiles.clear();
+    }
   }
 
   inline unsigned int profiler_listener::process_dependency(task_dependency* td)
@@ -447,8 +635,8 @@ std::unordered_set<profile*> free_profiles;
    * called at shutdown. But a good idea to do regardless. */
   void profiler_listener::delete_profiles(void) {
     // iterate over the map and free the objects in the map
-    unordered_map<task_identifier, profile*>::const_iterator it;
-    std::unique_lock<std::mutex> task_map_lock(_task_map_mutex);
+    profile_map::const_iterator it;
+    std::unique_lock<profile_map> task_map_lock(task_map);
     for(it = task_map.begin(); it != task_map.end(); it++) {
       delete it->second;
     }
@@ -561,6 +749,26 @@ std::unordered_set<profile*> free_profiles;
                 screen_output << string_format(FORMAT_PERCENT, tmp);
             }
         }
+        if (apex_options::timer_histograms()) {
+            const double percents[] = {50.0, 90.0, 99.0};
+            for (double percent : percents) {
+                double value = p->get_percentile(percent);
+                // zero if there were no complete calls (e.g. APEX MAIN)
+                if (value == 0.0) {
+                    screen_output << "    --n/a--";
+                    csv_output << ",";
+                    continue;
+                }
+                if (value * 1.0e-9 > 10000) {
+                    screen_output << "   " << string_format(FORMAT_SCIENTIFIC,
+                        value * 1.0e-9);
+                } else {
+                    screen_output << "   " << string_format(FORMAT_PERCENT,
+                        value * 1.0e-9);
+                }
+                csv_output << std::llround(value * 1.0e-3) << ",";
+            }
+        }
 #if APEX_HAVE_PAPI
         for (int i = 0 ; i < num_papi_counters ; i++) {
             screen_output  << "   " << string_format(FORMAT_SCIENTIFIC,
@@ -638,6 +846,58 @@ std::unordered_set<profile*> free_profiles;
       }
   }
 
+  /* List the timers throttled by APEX_THROTTLE_OVERHEAD, with the calls
+   * that weren't timed, and an estimate of the time they hid - those calls
+   * at the mean of the ones that were.  Call with the task_map locked. */
+  void profiler_listener::write_throttled_timers(
+    std::stringstream& screen_output) {
+    std::map<task_identifier, uint64_t> untimed;
+    {
+        std::unique_lock<std::mutex> l(_throttle_mtx);
+        if (throttled_ids.empty()) { return; }
+        int period = apex_options::throttle_sample_period();
+        // the same timer on different threads has different identifiers
+        for (task_identifier * id : throttled_ids) {
+            uint64_t calls = id->throttled_calls.load(memory_order_relaxed);
+            if (period > 0) { calls = calls - (calls / period); }
+            untimed[*id] += calls;
+        }
+    }
+    screen_output << endl << "Throttled timers (APEX overhead over "
+        << _throttle_overhead << "% of the mean)" << endl;
+    screen_output << string_format("%52s", "Timer") << " : "
+        << "#untimed |  hidden  " << endl;
+    screen_output << "----------------------------------------------"
+        << "--------------------------" << endl;
+    for (auto& it : untimed) {
+        task_identifier task_id(it.first);
+        string shorter(task_id.get_name());
+        if (shorter.size() > 52) {
+            shorter.resize(49);
+            shorter.resize(52, '.');
+        }
+        screen_output << string_format("%52s", shorter.c_str()) << " : ";
+        if (it.second < 999999) {
+            screen_output << string_format(PAD_WITH_SPACES,
+                to_string((int)it.second).c_str()) << "   ";
+        } else {
+            screen_output << string_format(FORMAT_SCIENTIFIC,
+                (double)it.second) << "   ";
+        }
+        profile_map::const_iterator p = task_map.find(task_id);
+        if (p == task_map.end()) {
+            screen_output << " --n/a--" << endl;
+            continue;
+        }
+        double hidden = it.second * p->second->get_mean_seconds();
+        if (hidden > 10000) {
+            screen_output << string_format(FORMAT_SCIENTIFIC, hidden) << endl;
+        } else {
+            screen_output << string_format(FORMAT_PERCENT, hidden) << endl;
+        }
+    }
+  }
+
   /* At program termination, write the measurements to the screen, or to CSV
    * file, or both. */
   void profiler_listener::finalize_profiles(dump_event_data &data) {
@@ -683,13 +943,22 @@ std::unordered_set<profile*> free_profiles;
     screen_output << "Worker Threads observed: "
         << num_worker_threads << endl;
     screen_output << "Available CPU time: "
-        << total_main << " seconds" << endl << endl;
+        << total_main << " seconds" << endl;
+    uint64_t dropped = 0;
+    uint64_t spilled = 0;
+    queue_full_counts(dropped, spilled);
+    // only worth mentioning if the queues filled up
+    if (dropped > 0 || spilled > 0) {
+        screen_output << "Timers dropped (queue full): " << dropped << endl;
+        screen_output << "Timers spilled (queue full): " << spilled << endl;
+    }
+    screen_output << endl;
     map<apex_function_address, profile*>::const_iterator it;
     double total_accumulated = 0.0;
-    unordered_map<task_identifier, profile*>::const_iterator it2;
+    profile_map::const_iterator it2;
     std::vector<task_identifier> id_vector;
     // iterate over the counters, and sort their names
-    std::unique_lock<std::mutex> task_map_lock(_task_map_mutex);
+    std::unique_lock<profile_map> task_map_lock(task_map);
     for(it2 = task_map.begin(); it2 != task_map.end(); it2++) {
         task_identifier task_id = it2->first;
         profile * p = it2->second;
@@ -699,6 +968,12 @@ std::unordered_set<profile*> free_profiles;
     }
     csv_output << "\"counter\",\"num samples\",\"minimum\",\"mean\""
         << "\"maximum\",\"stddev\"" << endl;
+    if (dropped > 0 || spilled > 0) {
+        csv_output << "\"Timers dropped (queue full)\",1," << dropped << ","
+            << dropped << "," << dropped << ",0" << endl;
+        csv_output << "\"Timers spilled (queue full)\",1," << spilled << ","
+            << spilled << "," << spilled << ",0" << endl;
+    }
     if (id_vector.size() > 0) {
         screen_output << "Counter                                   : "
         << "#samples | minimum |    mean  |  maximum |  stddev " << endl;
@@ -720,6 +995,10 @@ std::unordered_set<profile*> free_profiles;
         screen_output << "\n" << endl;
     }
     csv_output << "\n\n\"task\",\"num calls\",\"total microseconds\"";
+    if (apex_options::timer_histograms()) {
+       csv_output << ",\"p50 microseconds\",\"p90 microseconds\""
+                  << ",\"p99 microseconds\"";
+    }
 #if APEX_HAVE_PAPI
     for (int i = 0 ; i < num_papi_counters ; i++) {
        csv_output << ",\"" << metric_names[i] << "\"";
@@ -742,14 +1021,20 @@ std::unordered_set<profile*> free_profiles;
          index += 2;
     }
     screen_output << "Timer                                                : "
-        << "#calls  |    mean  |   total  |  % total  "
-        << tmpstr;
+        << "#calls  |    mean  |   total  |  % total  ";
+    if (apex_options::timer_histograms()) {
+       screen_output << "|     p50  |     p90  |     p99  ";
+    }
+    screen_output << tmpstr;
     if (apex_options::track_memory()) {
        screen_output << "|  allocs |  (bytes) |    frees |   (bytes) ";
     }
     screen_output << endl;
     screen_output << "----------------------------------------------"
         << "--------------------------------------------------";
+    if (apex_options::timer_histograms()) {
+        screen_output << "---------------------------------";
+    }
     if (apex_options::track_memory()) {
         screen_output << "--------------------------------------------";
     }
@@ -791,6 +1076,9 @@ std::unordered_set<profile*> free_profiles;
     }
     screen_output << "--------------------------------------------------"
         << "----------------------------------------------";
+    if (apex_options::timer_histograms()) {
+        screen_output << "---------------------------------";
+    }
     if (apex_options::track_memory()) {
         screen_output << "--------------------------------------------";
     }
@@ -808,6 +1096,7 @@ std::unordered_set<profile*> free_profiles;
     total_ss << std::fixed << ((uint64_t)total_hpx_threads);
         screen_output << total_ss.str() << std::endl;
     //}
+    write_throttled_timers(screen_output);
     if (apex_options::use_screen_output() && node_id == 0) {
         cout << screen_output.str();
         data.output = screen_output.str();
@@ -896,8 +1185,8 @@ std::unordered_set<profile*> free_profiles;
     task_dependencies.clear();
 
     // output nodes with  "main" [shape=box; style=filled; fillcolor="#ff0000" ];
-    unordered_map<task_identifier, profile*>::const_iterator it;
-    std::unique_lock<std::mutex> task_map_lock(_task_map_mutex);
+    profile_map::const_iterator it;
+    std::unique_lock<profile_map> task_map_lock(task_map);
     for(it = task_map.begin(); it != task_map.end(); it++) {
       profile * p = it->second;
       // shouldn't happen, but?
@@ -1028,11 +1317,16 @@ std::unordered_set<profile*> free_profiles;
     // name format: profile.nodeid.contextid.threadid
     myfile.open(datname.str().c_str());
     int counter_events = 0;
+    // the queue full counts go in as user events, if there are any
+    uint64_t dropped = 0;
+    uint64_t spilled = 0;
+    queue_full_counts(dropped, spilled);
+    int queue_events = (dropped > 0 || spilled > 0) ? 2 : 0;
 
     // Determine number of counter events, as these need to be
     // excluded from the number of normal timers
-    unordered_map<task_identifier, profile*>::const_iterator it2;
-    std::unique_lock<std::mutex> task_map_lock(_task_map_mutex);
+    profile_map::const_iterator it2;
+    std::unique_lock<profile_map> task_map_lock(task_map);
     for(it2 = task_map.begin(); it2 != task_map.end(); it2++) {
       profile * p = it2->second;
       if(p->get_type() == APEX_COUNTER) {
@@ -1075,9 +1369,17 @@ std::unordered_set<profile*> free_profiles;
     myfile << "0 aggregates" << endl;
 
     // Now process the counters, if there are any.
-    if(counter_events > 0) {
-      myfile << counter_events << " userevents" << endl;
+    if(counter_events + queue_events > 0) {
+      myfile << counter_events + queue_events << " userevents" << endl;
       myfile << "# eventname numevents max min mean sumsqr" << endl;
+      if (queue_events > 0) {
+        myfile << "\"Timers dropped (queue full)\" 1 " << dropped << " "
+               << dropped << " " << dropped << " "
+               << (double)dropped * (double)dropped << " " << endl;
+        myfile << "\"Timers spilled (queue full)\" 1 " << spilled << " "
+               << spilled << " " << spilled << " "
+               << (double)spilled * (double)spilled << " " << endl;
+      }
       for(it2 = task_map.begin(); it2 != task_map.end(); it2++) {
         profile * p = it2->second;
         if(p->get_type() == APEX_COUNTER) {
@@ -1127,12 +1429,107 @@ std::unordered_set<profile*> free_profiles;
       consumer_task_running.clear(memory_order_release);
   }
 
+#ifndef APEX_HAVE_HPX
+  /* Start the APEX_CONSUMER_THREADS pool, if there is one. */
+  void profiler_listener::start_consumers(void) {
+      int num_consumers = apex_options::consumer_threads();
+      for (int k = 0 ; k < num_consumers ; k++) {
+          partitions.push_back(new consumer_partition_t());
+      }
+      for (int k = 0 ; k < num_consumers ; k++) {
+          partitions[k]->thread =
+              new std::thread(consumer_partition_wrapper, this, k);
+      }
+  }
+
+  /* Wake the consumers one last time, so they see _done and exit. */
+  void profiler_listener::stop_consumers(void) {
+      for (auto partition : partitions) {
+          if (partition->thread != nullptr) {
+              partition->signal.post();
+              partition->thread->join();
+              delete partition->thread;
+              partition->thread = nullptr;
+          }
+      }
+  }
+
+  /* Called after a producer queues a record.  Wake the queue's own
+   * consumer, unless it's already awake.  If it is, and this queue is
+   * backing up, wake an idle consumer to help out. */
+  void profiler_listener::wake_consumer(profiler_queue_t * queue) {
+      size_t num_consumers = partitions.size();
+      size_t k = queue->index % num_consumers;
+      // seq_cst, to pair with the consumer's check in process_partition
+      if (!partitions[k]->busy.exchange(true, memory_order_seq_cst)) {
+          partitions[k]->signal.post();
+          return;
+      }
+      if (queue->size_approx() < APEX_STEAL_THRESHOLD(queue)) { return; }
+      for (size_t j = 1 ; j < num_consumers ; j++) {
+          consumer_partition_t * other = partitions[(k + j) % num_consumers];
+          if (!other->busy.exchange(true, memory_order_acq_rel)) {
+              other->signal.post();
+              return;
+          }
+      }
+  }
+
+  void profiler_listener::consumer_partition_wrapper(profiler_listener * pl,
+      size_t k) {
+      if (apex_options::pin_apex_threads()) {
+            set_thread_affinity();
+      }
+      pl->process_partition(k);
+  }
+
+  /* The main loop for one of the pool's consumer threads.  Drain the
+   * queues in this partition, then any other queue that has backed up and
+   * isn't being drained by its own consumer. */
+  void profiler_listener::process_partition(size_t k) {
+      initialize_worker_thread_for_tau();
+      consumer_partition_t * mine = partitions[k];
+      size_t num_consumers = partitions.size();
+      auto process = [this](profiler_record& p) { process_profile(p, 0); };
+      std::vector<profiler_queue_t*> queues;
+      while (!_done) {
+          mine->signal.wait();
+          do {
+              copy_queues(queues);
+              for (size_t q = k ; q < queues.size() && !_done ;
+                  q += num_consumers) {
+                  queues[q]->drain(process);
+              }
+              for (size_t q = 0 ; q < queues.size() && !_done ; q++) {
+                  if (q % num_consumers != k &&
+                      queues[q]->size_approx() >=
+                      APEX_STEAL_THRESHOLD(queues[q])) {
+                      queues[q]->try_drain(process);
+                  }
+              }
+              mine->busy.store(false, memory_order_seq_cst);
+              /* A producer that queued after we drained it, but saw busy
+               * still set, didn't post - so look again before waiting. */
+          } while (!_done && partition_pending(queues, k) &&
+              !mine->busy.exchange(true, memory_order_seq_cst));
+      }
+  }
+
+  bool profiler_listener::partition_pending(
+      const std::vector<profiler_queue_t*>& queues, size_t k) {
+      std::atomic_thread_fence(memory_order_seq_cst);
+      for (size_t q = k ; q < queues.size() ; q += partitions.size()) {
+          if (queues[q]->size_approx() > 0) { return true; }
+      }
+      return false;
+  }
+#endif
+
   bool profiler_listener::concurrent_cleanup(int i){
       //set_thread_affinity(i);
-      std::shared_ptr<profiler> p;
-      while(allqueues[i]->try_dequeue(p)) {
-             process_profile(p,0);
-      }
+      allqueues[i]->drain([this](profiler_record& p) {
+          process_profile(p,0);
+      });
       return true;
   }
 
@@ -1165,7 +1562,6 @@ std::unordered_set<profile*> free_profiles;
     start(prof);
     */
 
-    std::shared_ptr<profiler> p;
     task_dependency* td;
 #ifdef APEX_HAVE_HPX
     //bool schedule_another_task = false;
@@ -1175,17 +1571,10 @@ std::unordered_set<profile*> free_profiles;
             std::unique_lock<std::mutex> queue_lock(queue_mtx);
             num_queues = allqueues.size();
         }
-        for (size_t q = 0 ; q < num_queues ; q++) {
-            int i = 0;
-            while(!_done && allqueues[q]->try_dequeue(p)) {
+        for (size_t q = 0 ; q < num_queues && !_done ; q++) {
+            allqueues[q]->drain([this](profiler_record& p) {
                 process_profile(p, 0);
-                /*
-                if (++i > 1000 && !synchronous_flush) {
-                    schedule_another_task = true;
-                    break;
-                }
-                */
-            }
+            });
         }
     }
     if (apex_options::use_taskgraph_output()) {
@@ -1221,10 +1610,10 @@ std::unordered_set<profile*> free_profiles;
             {
                 num_queues = allqueues.size();
             }
-            for (size_t q = 0 ; q < num_queues ; q++) {
-                while(!_done && allqueues[q]->try_dequeue(p)) {
+            for (size_t q = 0 ; q < num_queues && !_done ; q++) {
+                allqueues[q]->drain([this](profiler_record& p) {
                     process_profile(p, 0);
-                }
+                });
             }
         }
         if (apex_options::use_taskgraph_output()) {
@@ -1337,6 +1726,9 @@ if (rc != 0) cout << "PAPI error! " << name << ": " << PAPI_strerror(rc) << endl
       consumer_thread = new std::thread(consumer_process_profiles_wrapper);
 #endif
 #endif // APEX_SYNCHRONOUS_PROCESSING
+#ifndef APEX_HAVE_HPX
+      start_consumers();
+#endif
 
 #if APEX_HAVE_PAPI
       initialize_PAPI(true);
@@ -1416,7 +1808,13 @@ if (rc != 0) cout << "PAPI error! " << name << ": " << PAPI_strerror(rc) << endl
     // wait until any other threads are done processing dependencies
     while(consumer_task_running.test_and_set(memory_order_acq_rel)) { }
 #endif
+#else // APEX_SYNCHRONOUS_PROCESSING
+#ifndef APEX_HAVE_HPX
+    // wait until any other thread is done processing a batch
+    while(consumer_task_running.test_and_set(memory_order_acq_rel)) { }
+#endif
 #endif // APEX_SYNCHRONOUS_PROCESSING
+      merge_thread_profiles();
 
       // output to screen?
       if ((apex_options::use_screen_output() && node_id == 0) ||
@@ -1489,7 +1887,7 @@ if (rc != 0) cout << "PAPI error! " << name << ": " << PAPI_strerror(rc) << endl
       if (data.reset) {
           reset_all();
       }
-#ifndef APEX_SYNCHRONOUS_PROCESSING
+#if !defined(APEX_SYNCHRONOUS_PROCESSING) || !defined(APEX_HAVE_HPX)
       // on_dump() releasing the "task_running" flag
       consumer_task_running.clear(memory_order_release);
 #endif
@@ -1522,7 +1920,9 @@ if (rc != 0) cout << "PAPI error! " << name << ": " << PAPI_strerror(rc) << endl
       }
 #endif
 #endif // APEX_SYNCHRONOUS_PROCESSING
-
+#ifndef APEX_HAVE_HPX
+      stop_consumers();
+#endif
     }
   }
 
@@ -1561,6 +1961,23 @@ if (rc != 0) cout << "PAPI error! " << name << ": " << PAPI_strerror(rc) << endl
   inline bool profiler_listener::_common_start(std::shared_ptr<task_wrapper>
     &tt_ptr, bool is_resume) {
     if (!_done) {
+      uint64_t overhead_start = 0;
+      if (_throttle_overhead > 0.0) {
+        task_identifier * id = tt_ptr->get_task_id();
+        if (id->throttled.load(memory_order_relaxed)) {
+          // resumes aren't calls, and they aren't timed either
+          if (is_resume) { return false; }
+          // count the call, but only time one in throttle_sample_period
+          uint64_t calls =
+            id->throttled_calls.fetch_add(1, memory_order_relaxed) + 1;
+          int period = apex_options::throttle_sample_period();
+          if (period <= 0 || calls % period != 0) { return false; }
+        } else if (++overhead_countdown >= APEX_OVERHEAD_SAMPLE_PERIOD) {
+          // time ourselves, from here until the end of _common_stop
+          overhead_countdown = 0;
+          overhead_start = profiler::now_ns();
+        }
+      }
 #if defined(APEX_THROTTLE)
       if (!apex_options::use_tau()) {
         // if this timer is throttled, return without doing anything
@@ -1607,12 +2024,128 @@ if (rc != 0) cout << "PAPI error! " << name << ": " << PAPI_strerror(rc) << endl
           }
       }
 #endif
+      if (overhead_start > 0) {
+          // never zero, that means "not sampled"
+          p->overhead_ns = profiler::now_ns() - overhead_start + 1;
+      }
     } else {
         return false;
     }
     return true;
   }
 
+  queue_full_policy profiler_listener::parse_queue_full_policy(void) {
+      std::string policy(apex_options::queue_full_policy());
+      if (policy.compare("block") == 0) {
+          return queue_full_policy::BLOCK;
+      } else if (policy.compare("drop") == 0) {
+          return queue_full_policy::DROP;
+      } else if (policy.compare("inline") == 0) {
+          return queue_full_policy::INLINE;
+      } else if (policy.compare("spill") != 0) {
+          fprintf(stderr, "APEX: unknown APEX_QUEUE_FULL_POLICY '%s', "
+              "using spill\n", policy.c_str());
+      }
+      return queue_full_policy::SPILL;
+  }
+
+  /* The ring holds a whole profiler_record per slot, so keep it sane.
+   * These parsers run from the listener's constructor, which can be
+   * before iostreams are initialized, so they warn with stdio. */
+  size_t profiler_listener::parse_queue_capacity(void) {
+      const int min_capacity = 2;
+      const int max_capacity = 1 << 20;
+      int capacity = apex_options::queue_capacity();
+      if (capacity < min_capacity || capacity > max_capacity) {
+          int clamped = capacity < min_capacity ? min_capacity : max_capacity;
+          fprintf(stderr, "APEX: APEX_QUEUE_CAPACITY %d is out of range "
+              "[%d, %d], using %d\n", capacity, min_capacity, max_capacity,
+              clamped);
+          capacity = clamped;
+      }
+      return (size_t)capacity;
+  }
+
+  /* How many timers were dropped or spilled because a queue was full */
+  void profiler_listener::queue_full_counts(uint64_t& dropped,
+      uint64_t& spilled) {
+      dropped = 0;
+      spilled = 0;
+      std::unique_lock<std::mutex> queue_lock(queue_mtx);
+      for (auto q : allqueues) {
+          dropped += q->dropped.load(memory_order_relaxed);
+          spilled += q->spilled.load(memory_order_relaxed);
+      }
+  }
+
+  /* Copy the queue pointers out.  Queues are never removed before
+   * finalize, but a new thread's push_back can move the vector, so it is
+   * not indexed without the lock. */
+  void profiler_listener::copy_queues(std::vector<profiler_queue_t*>& queues) {
+      std::unique_lock<std::mutex> queue_lock(queue_mtx);
+      queues.assign(allqueues.begin(), allqueues.end());
+  }
+
+  /* Process every thread's queue on this thread.  The caller holds
+   * consumer_task_running, so only one thread does this at a time. */
+  void profiler_listener::drain_all_queues(void) {
+      std::vector<profiler_queue_t*> queues;
+      copy_queues(queues);
+      for (size_t q = 0 ; q < queues.size() && !_done ; q++) {
+          queues[q]->drain([this](profiler_record& r) {
+              process_profile(r, 0);
+          });
+      }
+  }
+
+  /* Put a record on this thread's queue.  If the ring is full, do what
+   * APEX_QUEUE_FULL_POLICY says.  Resets are never dropped or processed
+   * out of order, so they always spill. */
+  void profiler_listener::enqueue_record(profiler_queue_t * queue,
+      const profiler_record& r) {
+      if (queue->try_enqueue(r)) { return; }
+      queue_full_policy policy = _queue_full_policy;
+      if (r.is_reset != reset_type::NONE) { policy = queue_full_policy::SPILL; }
+      switch (policy) {
+      case queue_full_policy::DROP:
+          queue->dropped.fetch_add(1, memory_order_relaxed);
+          return;
+      case queue_full_policy::INLINE: {
+          // this thread is outrunning the consumer, so aggregate its
+          // timers itself until there's room again
+          profiler_record local(r);
+          process_profile_locally(local);
+          queue->spilled.fetch_add(1, memory_order_relaxed);
+          return;
+      }
+      case queue_full_policy::BLOCK:
+          while (!queue->try_enqueue(r)) {
+              if (_done) {
+                  // nobody will drain it now
+                  queue->dropped.fetch_add(1, memory_order_relaxed);
+                  return;
+              }
+#if !defined(APEX_HAVE_HPX) && defined(APEX_SYNCHRONOUS_PROCESSING)
+              if (!partitions.empty()) {
+                  wake_consumer(queue);
+              } else if (!consumer_task_running.test_and_set(
+                  memory_order_acq_rel)) {
+                  // nobody else is consuming, so make room ourselves
+                  drain_all_queues();
+                  consumer_task_running.clear(memory_order_release);
+                  continue;
+              }
+#endif
+              std::this_thread::yield();
+          }
+          return;
+      default:
+          queue->spill(r);
+          queue->spilled.fetch_add(1, memory_order_relaxed);
+          return;
+      }
+  }
+
   inline void profiler_listener::push_profiler(int my_tid, profiler& p) {
       APEX_UNUSED(my_tid);
       // if we aren't processing profiler objects, just return.
@@ -1620,25 +2153,61 @@ if (rc != 0) cout << "PAPI error! " << name << ": " << PAPI_strerror(rc) << endl
 #ifdef APEX_TRACE_APEX
       if (p.get_task_id()->name == "apex::process_profiles_sync") { return; }
 #endif
+      if (apex_options::thread_local_profiles() &&
+          p.is_reset == reset_type::NONE) {
+          profiler_record r(p);
+          process_profile_locally(r);
+          return;
+      }
       process_profile(p,0);
       return;
   }
 
   inline void profiler_listener::push_profiler(int my_tid,
     std::shared_ptr<profiler> &p) {
+      enqueue_profiler(my_tid, *p);
+  }
+
+  inline void profiler_listener::enqueue_profiler(int my_tid, profiler &p) {
       APEX_UNUSED(my_tid);
       // if we aren't processing profiler objects, just return.
       if (!apex_options::process_async_state()) { return; }
 #ifdef APEX_TRACE_APEX
-      if (p->get_task_id()->name == "apex::process_profiles_async") { return; }
+      if (p.get_task_id()->name == "apex::process_profiles_async") { return; }
 #endif
-      thequeue()->enqueue(p);
+      if (apex_options::thread_local_profiles()) {
+          profiler_record r(p);
+          if (p.is_reset == reset_type::NONE) {
+              process_profile_locally(r);
+          } else {
+              process_profile(r, 0);
+          }
+          return;
+      }
+      // copy out what the consumer needs, so the profiler can be freed now
+      enqueue_record(thequeue(), profiler_record(p));
 #ifndef APEX_HAVE_HPX
+#ifdef APEX_SYNCHRONOUS_PROCESSING
+      if (!partitions.empty()) {
+        wake_consumer(thequeue());
+        return;
+      }
+      // There is no consumer thread, so once this thread has queued a
+      // batch, process all the queues here.  That bounds the memory held
+      // by queued profilers, and hands them back to their pools for reuse.
+      // Only one thread processes at a time, the others keep queueing.
+      if (thequeue()->size_approx() >= APEX_SYNCHRONOUS_BATCH_SIZE(thequeue())
+          && !consumer_task_running.test_and_set(memory_order_acq_rel)) {
+        drain_all_queues();
+        consumer_task_running.clear(memory_order_release);
+      }
+#else
       // Check to see if the consumer is already running, to avoid calling
       // "post" too frequently - it is rather costly.
       if(!consumer_task_running.test_and_set(memory_order_acq_rel)) {
         queue_signal.post();
       }
+#endif // APEX_SYNCHRONOUS_PROCESSING
 #else
       // only fire off an action 0.1% of the time.
       static int thresh = RAND_MAX/1000;
@@ -1649,20 +2218,29 @@ if (rc != 0) cout << "PAPI error! " << name << ": " << PAPI_strerror(rc) << endl
   }
 
   /* Stop the timer, if applicable, and queue the profiler object */
-  inline void profiler_listener::_common_stop(std::shared_ptr<profiler> &p,
-    bool is_yield) {
+  inline void profiler_listener::_common_stop(profiler &p, bool is_yield) {
     if (!_done) {
-      if (p) {
-        p->stop(is_yield);
+        p.stop(is_yield);
 #if APEX_HAVE_PAPI
         if (num_papi_counters > 0 && !apex_options::papi_suspend() &&
             thread_papi_state == papi_running) {
-            int rc = PAPI_read( EventSet, p->papi_stop_values );
+            int rc = PAPI_read( EventSet, p.papi_stop_values );
             PAPI_ERROR_CHECK("PAPI_read");
         }
 #endif
-        push_profiler(my_tid, p);
-      }
+        enqueue_profiler(my_tid, p);
+        if (p.overhead_ns > 0) {
+            /* Only the listener's share of the overhead - the bookkeeping
+             * in apex::start and apex::stop isn't seen, and outliers are
+             * thrown away, so this errs low. */
+            uint64_t overhead = p.overhead_ns +
+                (profiler::now_ns() - p.end_ns);
+            if (overhead < APEX_OVERHEAD_MAX_SAMPLE_NS) {
+                task_identifier * id = p.get_task_id();
+                id->overhead_ns.fetch_add(overhead, memory_order_relaxed);
+                id->overhead_samples.fetch_add(1, memory_order_relaxed);
+            }
+        }
     }
   }
 
@@ -1679,11 +2257,19 @@ if (rc != 0) cout << "PAPI error! " << name << ": " << PAPI_strerror(rc) << endl
 
    /* Stop the timer */
   void profiler_listener::on_stop(std::shared_ptr<profiler> &p) {
-    _common_stop(p, p->is_resume); // don't change the yield/resume value!
+    if (p) { on_stop(*p); }
+  }
+
+  void profiler_listener::on_stop(profiler &p) {
+    _common_stop(p, p.is_resume); // don't change the yield/resume value!
   }
 
   /* Stop the timer, but don't increment the number of calls */
   void profiler_listener::on_yield(std::shared_ptr<profiler> &p) {
+    if (p) { on_yield(*p); }
+  }
+
+  void profiler_listener::on_yield(profiler &p) {
     _common_stop(p, true);
   }
 
@@ -1705,15 +2291,15 @@ if (rc != 0) cout << "PAPI error! " << name << ": " << PAPI_strerror(rc) << endl
   /* When a sample value is processed, save it as a profiler object, and queue it. */
   void profiler_listener::on_sample_value(sample_value_event_data &data) {
     if (!_done) {
+      task_identifier * id = data.counter_id != nullptr ? data.counter_id :
+        task_identifier::get_task_id(*data.counter_name);
       // don't make a shared pointer if not necessary!
 #ifdef APEX_SYNCHRONOUS_PROCESSING
-      profiler p(task_identifier::get_task_id(
-        *data.counter_name), data.counter_value);
+      profiler p(id, data.counter_value);
       p.is_counter = data.is_counter;
 #else // APEX_SYNCHRONOUS_PROCESSING
       std::shared_ptr<profiler> p =
-        std::make_shared<profiler>(task_identifier::get_task_id(
-        *data.counter_name), data.counter_value);
+        std::make_shared<profiler>(id, data.counter_value);
       p->is_counter = data.is_counter;
 #endif // APEX_SYNCHRONOUS_PROCESSING
       push_profiler(my_tid, p);
@@ -1778,6 +2364,16 @@ if (rc != 0) cout << "PAPI error! " << name << ": " << PAPI_strerror(rc) << endl
     APEX_UNUSED(data);
   }
 
+  /* Everything but custom events, and the task completions are only
+   * needed for the task graph. */
+  listener_event_mask profiler_listener::subscriptions(void) {
+    listener_event_mask mask = listen_all & ~listen_mask(listen_custom_event);
+    if (!apex_options::use_taskgraph_output()) {
+      mask &= ~listen_mask(listen_task_complete);
+    }
+    return mask;
+  }
+
   void profiler_listener::reset(task_identifier * id) {
     // don't make a shared pointer if not necessary!
 #ifdef APEX_SYNCHRONOUS_PROCESSING
@@ -1791,6 +2387,9 @@ if (rc != 0) cout << "PAPI error! " << name << ": " << PAPI_strerror(rc) << endl
 
   profiler_listener::~profiler_listener (void) {
       _done = true; // yikes!
+#ifndef APEX_HAVE_HPX
+      stop_consumers();
+#endif
       finalize();
       delete_profiles();
 #ifndef APEX_SYNCHRONOUS_PROCESSING
@@ -1811,6 +2410,21 @@ if (rc != 0) cout << "PAPI error! " << name << ": " << PAPI_strerror(rc) << endl
         dependency_queues.pop_back();
         delete(tmp);
     }
+#ifndef APEX_HAVE_HPX
+    while (partitions.size() > 0) {
+        auto tmp = partitions.back();
+        partitions.pop_back();
+        delete(tmp);
+    }
+#endif
+    while (allprofiles.size() > 0) {
+        auto tmp = allprofiles.back();
+        allprofiles.pop_back();
+        for (auto &kv : tmp->profiles) {
+            delete kv.second;
+        }
+        delete(tmp);
+    }
     for (auto tmp : free_profiles) {
         delete(tmp);
     }
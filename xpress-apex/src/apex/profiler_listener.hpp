@@ -24,12 +24,14 @@
 #include <atomic>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <sstream>
 #include <string>
 
 #include "profile.hpp"
+#include "profile_map.hpp"
 #include "thread_instance.hpp"
 #include <fstream>
 
@@ -68,13 +70,178 @@ using moodycamel::ConcurrentQueue;
 
 namespace apex {
 
-class profiler_queue_t : public ConcurrentQueue<std::shared_ptr<profiler> > {
+/* A completed timer (or counter sample, or reset request), as handed from
+ * the measured thread to whoever processes the profiles.  Everything that
+ * process_profile needs is copied out of the profiler, so the queues hold
+ * no references to profiler or task_wrapper objects.  Task identifiers and
+ * task tree nodes are never freed, so the raw pointers are safe. */
+struct profiler_record {
+    task_identifier * task_id;
+    dependency::Node * tree_node;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint64_t guid;
+    double value;
+    double allocations;
+    double frees;
+    double bytes_allocated;
+    double bytes_freed;
+#if APEX_HAVE_PAPI
+    double papi_values[8];
+#endif
+    bool is_counter;
+    bool is_resume;
+    reset_type is_reset;
+    profiler_record(void) {}
+    explicit profiler_record(profiler& p) :
+        task_id(p.get_task_id()),
+        tree_node(p.tt_ptr != nullptr ? p.tt_ptr->tree_node : nullptr),
+        start_ns(p.start_ns),
+        // counters and reset requests are never "stopped"
+        end_ns(p.is_counter ? p.start_ns :
+            (p.stopped ? p.end_ns : profiler::now_ns())),
+        guid(p.guid),
+        value(p.value),
+        allocations(p.allocations),
+        frees(p.frees),
+        bytes_allocated(p.bytes_allocated),
+        bytes_freed(p.bytes_freed),
+        is_counter(p.is_counter),
+        is_resume(p.is_resume),
+        is_reset(p.is_reset) {
+#if APEX_HAVE_PAPI
+        for (int i = 0 ; i < 8 ; i++) {
+            if (p.papi_stop_values[i] > p.papi_start_values[i]) {
+                papi_values[i] = p.papi_stop_values[i] -
+                    p.papi_start_values[i];
+            } else {
+                papi_values[i] = 0.0;
+            }
+        }
+#endif
+    }
+    task_identifier * get_task_id(void) const { return task_id; }
+    double elapsed(void) const {
+        return is_counter ? value : (double)(end_ns - start_ns);
+    }
+    double elapsed_seconds(void) const { return elapsed() * 1.0e-9; }
+    double normalized_timestamp(void) const {
+        return start_ns - profiler::get_global_start();
+    }
+};
+
+/* Single producer, single consumer ring of completed timers.  Only the
+ * owning thread pushes, and the consumer streams through the records in
+ * place.  What happens to records that don't fit while the consumer is
+ * behind is up to the APEX_QUEUE_FULL_POLICY - spill() puts them on an
+ * unbounded overflow queue.  The consumer side is locked, because
+ * on_dump() and the consumer can both drain the queues. */
+class profiler_queue_t {
 public:
-  profiler_queue_t() {}
+  /* The capacity is rounded up to a power of two */
+  profiler_queue_t(size_t capacity) : index(0), dropped(0), spilled(0),
+    _capacity(round_up(capacity)), _tail(0), _head_cache(0), _head(0),
+    _records(new profiler_record[_capacity]) {}
   virtual ~profiler_queue_t() {
-      //finalize();
+      delete[] _records;
+  }
+  /* Returns false if the ring is full */
+  bool try_enqueue(const profiler_record& r) {
+      size_t tail = _tail.load(std::memory_order_relaxed);
+      if (tail - _head_cache == _capacity) {
+          _head_cache = _head.load(std::memory_order_acquire);
+          if (tail - _head_cache == _capacity) {
+              return false;
+          }
+      }
+      _records[tail & (_capacity - 1)] = r;
+      _tail.store(tail + 1, std::memory_order_release);
+      return true;
+  }
+  void spill(const profiler_record& r) {
+      _overflow.enqueue(r);
+  }
+  size_t capacity(void) const { return _capacity; }
+  /* Call f on every record queued so far, returns how many. */
+  template <typename F>
+  size_t drain(F f) {
+      std::unique_lock<std::mutex> l(_consumer_mtx);
+      return _drain(f);
+  }
+  /* The same, unless another consumer is draining this queue already */
+  template <typename F>
+  size_t try_drain(F f) {
+      std::unique_lock<std::mutex> l(_consumer_mtx, std::try_to_lock);
+      if (!l.owns_lock()) { return 0; }
+      return _drain(f);
   }
+  size_t size_approx(void) const {
+      return (_tail.load(std::memory_order_relaxed) -
+          _head.load(std::memory_order_relaxed)) + _overflow.size_approx();
+  }
+  /* this queue's position in allqueues */
+  size_t index;
+  /* records that didn't fit in the ring, written only by the producer */
+  std::atomic<uint64_t> dropped;
+  std::atomic<uint64_t> spilled;
+private:
+  static size_t round_up(size_t capacity) {
+      size_t rounded = 2;
+      while (rounded < capacity) { rounded = rounded << 1; }
+      return rounded;
+  }
+  template <typename F>
+  size_t _drain(F& f) {
+      size_t head = _head.load(std::memory_order_relaxed);
+      size_t tail = _tail.load(std::memory_order_acquire);
+      size_t count = tail - head;
+      for ( ; head != tail ; head++) {
+          f(_records[head & (_capacity - 1)]);
+      }
+      _head.store(head, std::memory_order_release);
+      profiler_record r;
+      while (_overflow.try_dequeue(r)) {
+          f(r);
+          count++;
+      }
+      return count;
+  }
+  const size_t _capacity;
+  /* producer and consumer indices on separate cache lines (padded rather
+   * than aligned, because these are heap allocated before C++17) */
+  std::atomic<size_t> _tail;
+  size_t _head_cache;
+  char _pad0[64];
+  std::atomic<size_t> _head;
+  char _pad1[64];
+  profiler_record * _records;
+  std::mutex _consumer_mtx;
+  ConcurrentQueue<profiler_record> _overflow;
+};
+
+/* One thread's profiles, when APEX_THREAD_LOCAL_PROFILES is set (or its
+ * queue filled up under APEX_QUEUE_FULL_POLICY=inline).  The
+ * owning thread updates them inline as its timers stop - the lock is only
+ * contended while they are merged into the task_map, which empties them. */
+class thread_profiles_t {
+public:
+  std::mutex mtx;
+  std::unordered_map<task_identifier*, profile*> profiles;
+};
+
+#ifndef APEX_HAVE_HPX
+/* One of the consumer threads, when APEX_CONSUMER_THREADS is set.  Each
+ * one owns every Nth producer queue, and helps drain the others when
+ * they back up.  busy is set by the producer that wakes the consumer,
+ * and cleared when the consumer goes back to waiting. */
+class consumer_partition_t {
+public:
+  consumer_partition_t() : busy(false), thread(nullptr) {}
+  semaphore signal;
+  std::atomic<bool> busy;
+  std::thread * thread;
 };
+#endif
 
 class dependency_queue_t : public ConcurrentQueue<task_dependency*> {
 public:
@@ -84,6 +251,15 @@ public:
   }
 };
 
+/* What a thread does with a completed timer when its queue is full,
+ * from APEX_QUEUE_FULL_POLICY */
+enum struct queue_full_policy {
+    SPILL,  // put it on an unbounded overflow queue
+    BLOCK,  // wait for the consumer to make room
+    DROP,   // throw it away, and count it
+    INLINE  // fold it into the thread's own profiles, merged later
+};
+
 static const char * task_scatterplot_sample_filename = "apex_task_samples.";
 static const char * counter_scatterplot_sample_filename = "apex_counter_samples.";
 
@@ -109,17 +285,20 @@ private:
 #endif
   unsigned int process_profile(std::shared_ptr<profiler> &p, unsigned int tid);
   unsigned int process_profile(profiler& p, unsigned int tid);
+  unsigned int process_profile(profiler_record& p, unsigned int tid);
   unsigned int process_dependency(task_dependency* td);
+  void process_profile_locally(profiler_record& p);
+  void record_sample(profiler_record& p);
+  void throttle_check(task_identifier * id, profile * theprofile);
   int node_id;
   std::mutex _mtx;
   bool _common_start(std::shared_ptr<task_wrapper> &tt_ptr,
     bool is_resume); // internal, inline function
-  void _common_stop(std::shared_ptr<profiler> &p,
-    bool is_yield); // internal, inline function
+  void _common_stop(profiler &p, bool is_yield); // internal, inline function
   void push_profiler(int my_tid, std::shared_ptr<profiler> &p);
   void push_profiler(int my_tid, profiler &p);
-  std::unordered_map<task_identifier, profile*> task_map;
-  std::mutex _task_map_mutex;
+  void enqueue_profiler(int my_tid, profiler &p);
+  profile_map task_map;
   std::unordered_map<task_identifier, std::unordered_map<task_identifier,
     int>* > task_dependencies;
   /* an vector of profiler queues - so the consumer thread can access them */
@@ -127,6 +306,20 @@ private:
   std::vector<profiler_queue_t*> allqueues;
   profiler_queue_t * _construct_thequeue(void);
   profiler_queue_t * thequeue(void);
+  queue_full_policy _queue_full_policy;
+  static queue_full_policy parse_queue_full_policy(void);
+  size_t _queue_capacity;
+  static size_t parse_queue_capacity(void);
+  void queue_full_counts(uint64_t& dropped, uint64_t& spilled);
+  void enqueue_record(profiler_queue_t * queue, const profiler_record& r);
+  void copy_queues(std::vector<profiler_queue_t*>& queues);
+  void drain_all_queues(void);
+  /* The per-thread profiles, for APEX_THREAD_LOCAL_PROFILES and the
+   * inline queue policy */
+  std::vector<thread_profiles_t*> allprofiles;
+  std::atomic<size_t> _num_thread_profiles;
+  thread_profiles_t * _construct_thread_profiles(void);
+  thread_profiles_t * thread_profiles(void);
   /* The task dependency queues */
   std::vector<dependency_queue_t*> dependency_queues;
   dependency_queue_t * _construct_dependency_queue(void);
@@ -135,6 +328,12 @@ private:
 #if defined(APEX_THROTTLE)
   std::unordered_set<task_identifier> throttled_tasks;
 #endif
+  /* Adaptive throttling, with APEX_THROTTLE_OVERHEAD.  Every identifier
+   * that has been throttled, for the final report. */
+  double _throttle_overhead;
+  std::mutex _throttle_mtx;
+  std::vector<task_identifier*> throttled_ids;
+  void write_throttled_timers(std::stringstream& screen_output);
 #if APEX_HAVE_PAPI
   int num_papi_counters;
   std::vector<int> event_sets;
@@ -143,6 +342,14 @@ private:
 #endif
 #ifndef APEX_HAVE_HPX
   std::thread * consumer_thread;
+  std::vector<consumer_partition_t*> partitions;
+  void start_consumers(void);
+  void stop_consumers(void);
+  void wake_consumer(profiler_queue_t * queue);
+  void process_partition(size_t k);
+  bool partition_pending(const std::vector<profiler_queue_t*>& queues,
+      size_t k);
+  static void consumer_partition_wrapper(profiler_listener * pl, size_t k);
 #endif
   semaphore queue_signal;
   std::ofstream _task_scatterplot_sample_file;
@@ -155,7 +362,7 @@ public:
     this->node_id = node_id;
   }
   profiler_listener (void) : _initialized(false), _done(false),
-                             node_id(0), task_map()
+                             node_id(0), task_map(), _num_thread_profiles(0)
 #if APEX_HAVE_PAPI
                              , num_papi_counters(0), event_sets(8),
                              metric_names(0)
@@ -167,6 +374,11 @@ public:
       if (apex_options::task_scatterplot()) {
         profiler::get_global_start();
       }
+      _queue_full_policy = parse_queue_full_policy();
+      _queue_capacity = parse_queue_capacity();
+      // TAU needs to see every timer, as with APEX_THROTTLE
+      _throttle_overhead = apex_options::use_tau() ? 0.0 :
+          apex_options::throttle_overhead();
   };
   ~profiler_listener (void);
   void async_thread_setup(void);
@@ -182,6 +394,10 @@ public:
   bool on_start(std::shared_ptr<task_wrapper> &tt_ptr);
   void on_stop(std::shared_ptr<profiler> &p);
   void on_yield(std::shared_ptr<profiler> &p);
+  /* apex::stop and apex::yield call these directly, so they don't have to
+   * make a shared_ptr unless another listener wants one. */
+  void on_stop(profiler &p);
+  void on_yield(profiler &p);
   bool on_resume(std::shared_ptr<task_wrapper> &tt_ptr);
   void on_task_complete(std::shared_ptr<task_wrapper> &tt_ptr);
   void on_sample_value(sample_value_event_data &data);
@@ -189,6 +405,7 @@ public:
   void on_custom_event(custom_event_data &event_data);
   void on_send(message_event_data &data);
   void on_recv(message_event_data &data);
+  listener_event_mask subscriptions(void);
   // other methods
   std::ofstream& task_scatterplot_sample_file() {
       if (!_task_scatterplot_sample_file.is_open()) {
@@ -223,21 +440,24 @@ public:
   void reset(task_identifier * id);
   void reset_all(void);
   profile * get_profile(const task_identifier &id);
+  profile * get_profile(task_identifier * id);
   double get_non_idle_time(void);
   profile * get_idle_time(void);
   profile * get_idle_rate(void);
   std::vector<task_identifier>& get_available_profiles() {
     static std::vector<task_identifier> ids;
-    _task_map_mutex.lock();
+    merge_thread_profiles();
+    task_map.lock();
     if (task_map.size() > ids.size()) {
         ids.clear();
         for (auto kv : task_map) {
            ids.push_back(kv.first);
         }
     }
-    _task_map_mutex.unlock();
+    task_map.unlock();
     return ids;
   }
+  void merge_thread_profiles(void);
   void process_profiles(void);
   static void process_profiles_wrapper(void);
   static void consumer_process_profiles_wrapper(void);
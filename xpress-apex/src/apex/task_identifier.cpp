@@ -9,6 +9,8 @@
 #include "task_identifier.hpp"
 #include "thread_instance.hpp"
 #include "apex_api.hpp"
+#include <cstdint>
+#include <cstring>
 #include <mutex>
 #include <string>
 #include <utility>
@@ -180,5 +182,32 @@ std::mutex bfd_mutex;
           return tmp;
       }
   }
+
+  /* Most timer names are string literals or __func__, so the same address
+   * comes back over and over.  A small direct-mapped cache indexed by the
+   * address of the caller's string sits in front of the name map.  A hit
+   * costs a pointer compare and a strcmp - no std::string, no hashing of
+   * the name, no map lookup.  The strcmp catches buffers that are reused
+   * for different names. */
+  task_identifier * task_identifier::get_task_id (const char * n) {
+      struct cache_entry {
+          const char * key;
+          task_identifier * id;
+      };
+      static constexpr size_t cache_size = 256; // must be a power of two
+      static APEX_NATIVE_TLS cache_entry * cache = nullptr;
+      if (cache == nullptr) {
+          cache = new cache_entry[cache_size]();
+      }
+      uintptr_t addr = reinterpret_cast<uintptr_t>(n);
+      cache_entry& entry = cache[(addr ^ (addr >> 8)) & (cache_size - 1)];
+      if (entry.key == n && strcmp(entry.id->name.c_str(), n) == 0) {
+          return entry.id;
+      }
+      task_identifier * id = get_task_id(std::string(n));
+      entry.key = n;
+      entry.id = id;
+      return id;
+  }
 }
 
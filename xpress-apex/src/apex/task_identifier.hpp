@@ -10,6 +10,7 @@
 
 #include "apex_types.h"
 #include "utils.hpp"
+#include <atomic>
 #include <functional>
 #include <string>
 #include <unordered_map>
@@ -45,23 +46,54 @@ public:
   std::string name;
   std::string _resolved_name;
   bool has_name;
+  /* The event_filter decision for this identifier, worked out the first
+   * time it is checked (see event_filter::exclude). */
+  enum { filter_unknown, filter_included, filter_excluded };
+  std::atomic<uint8_t> filter_state;
+  /* Adaptive throttling state (see APEX_THROTTLE_OVERHEAD).  Identifiers
+   * are interned per thread, so each thread throttles its own copy of a
+   * timer.  The overhead is only sampled, one timer in so many. */
+  std::atomic<bool> throttled;
+  std::atomic<uint64_t> overhead_ns;
+  std::atomic<uint64_t> overhead_samples;
+  std::atomic<uint64_t> throttled_calls; // starts since it was throttled
   task_identifier(void) :
-      address(0L), name(""), _resolved_name(""), has_name(false) {};
+      address(0L), name(""), _resolved_name(""), has_name(false),
+      filter_state(filter_unknown), throttled(false), overhead_ns(0),
+      overhead_samples(0), throttled_calls(0) {};
   task_identifier(apex_function_address a) :
-      address(a), name(""), _resolved_name(""), has_name(false) {};
+      address(a), name(""), _resolved_name(""), has_name(false),
+      filter_state(filter_unknown), throttled(false), overhead_ns(0),
+      overhead_samples(0), throttled_calls(0) {};
   task_identifier(const std::string& n) :
-      address(0L), name(n), _resolved_name(""), has_name(true) {};
+      address(0L), name(n), _resolved_name(""), has_name(true),
+      filter_state(filter_unknown), throttled(false), overhead_ns(0),
+      overhead_samples(0), throttled_calls(0) {};
   // The copy constructor doesn't copy the resolved name.  That's because
   // it would be too expensive to lock control to it, since it can be
   // updated by another thread. Therefore, leave it unresolved, no one will
   // ask for the resolved name until program exit, or in policies.
   task_identifier(const task_identifier& rhs) :
       address(rhs.address), name(rhs.name),
-      _resolved_name(""), has_name(rhs.has_name) { };
-  task_identifier& operator=(const task_identifier& rhs) = default;
+      _resolved_name(""), has_name(rhs.has_name),
+      filter_state(filter_unknown), throttled(false), overhead_ns(0),
+      overhead_samples(0), throttled_calls(0) { };
+  task_identifier& operator=(const task_identifier& rhs) {
+      address = rhs.address;
+      name = rhs.name;
+      _resolved_name = rhs._resolved_name;
+      has_name = rhs.has_name;
+      filter_state.store(filter_unknown, std::memory_order_relaxed);
+      throttled.store(false, std::memory_order_relaxed);
+      overhead_ns.store(0, std::memory_order_relaxed);
+      overhead_samples.store(0, std::memory_order_relaxed);
+      throttled_calls.store(0, std::memory_order_relaxed);
+      return *this;
+  }
 
   static task_identifier * get_task_id (apex_function_address a);
   static task_identifier * get_task_id (const std::string& n);
+  static task_identifier * get_task_id (const char * n);
   std::string get_name(bool resolve = true);
   std::string get_short_name();
   ~task_identifier() { }
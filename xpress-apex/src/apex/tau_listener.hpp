@@ -47,6 +47,11 @@ public:
   void on_send(message_event_data &data) { APEX_UNUSED(data); };
   void on_recv(message_event_data &data) { APEX_UNUSED(data); };
   void set_node_id(int node_id, int node_count);
+  listener_event_mask subscriptions(void) {
+    return listen_mask(listen_start) | listen_mask(listen_stop) |
+      listen_mask(listen_yield) | listen_mask(listen_resume) |
+      listen_mask(listen_sample_value);
+  }
   void set_metadata(const char * name, const char * value);
 
   static void Tau_start_wrapper(const char * name);
@@ -13,6 +13,7 @@
 #include <fstream>
 #include <memory>
 #include <iomanip>
+#include <algorithm>
 
 using namespace std;
 
@@ -21,7 +22,7 @@ namespace apex {
 bool trace_event_listener::_initialized(false);
 
 trace_event_listener::trace_event_listener (void) : _terminate(false),
-    num_events(0), _end_time(0.0) {
+    num_events(0), _next_vthread(1), _end_time(0.0) {
     std::stringstream ss;
     ss << fixed << "{\n";
     ss << "\"displayTimeUnit\": \"ms\",\n";
@@ -195,7 +196,7 @@ std::string trace_event_listener::make_tid (async_thread_node &node) {
     /* There is a potential for overlap here, but not a high potential.  The CPU and the GPU
      * would BOTH have to spawn 64k+ threads/streams for this to happen. */
     if (vthread_map.count(node) == 0) {
-        size_t id = vthread_map.size()+1;
+        size_t id = _next_vthread++;
         //uint32_t id_reversed = simple_reverse(id);
         uint32_t id_shifted = id << 16;
         vthread_map.insert(std::pair<async_thread_node, size_t>(node,id_shifted));
@@ -233,6 +234,52 @@ std::string trace_event_listener::make_tid (async_thread_node &node) {
     return label;
 }
 
+std::string trace_event_listener::make_tid (kokkos_thread_node &node) {
+    static const char * types[] = {"Serial", "OpenMP", "Cuda", "HIP",
+        "OpenMPTarget", "HPX", "Threads", "SYCL", "OpenACC", "Unknown"};
+    std::unique_lock<std::mutex> l(_kokkos_vthread_mutex);
+    if (kokkos_vthread_map.count(node) == 0) {
+        size_t id = _next_vthread++;
+        uint32_t id_shifted = id << 16;
+        kokkos_vthread_map.insert(
+            std::pair<kokkos_thread_node, size_t>(node,id_shifted));
+        std::stringstream ss;
+        ss << "{\"name\":\"thread_name\""
+           << ",\"ph\":\"M\",\"pid\":" << saved_node_id
+           << ",\"tid\":" << id_shifted
+           << ",\"args\":{\"name\":";
+        ss << "\"Kokkos " << types[std::min(node._type, 9u)] << " ["
+           << node._device << ":" << node._instance << "]\"";
+        ss << "}},\n";
+        /* make sure the instance threads come after CPU threads
+         * by giving them a thread sort index of max int. */
+        ss << "{\"name\":\"thread_sort_index\""
+           << ",\"ph\":\"M\",\"pid\":" << saved_node_id
+           << ",\"tid\":" << id_shifted
+           << ",\"args\":{\"sort_index\":" << UINT32_MAX << "}},\n";
+        write_to_trace(ss);
+    }
+    std::stringstream ss;
+    ss << kokkos_vthread_map[node];
+    std::string label{ss.str()};
+    return label;
+}
+
+void trace_event_listener::on_kokkos_instance_event(kokkos_thread_node &node,
+    const std::string &name, uint64_t start_ns, uint64_t stop_ns) {
+    if (!_terminate) {
+        std::stringstream ss;
+        std::string tid{make_tid(node)};
+        ss << "{\"name\":\"" << name
+              << "\",\"ph\":\"X\",\"pid\":"
+              << saved_node_id << ",\"tid\":" << tid
+              << ",\"ts\":" << fixed << start_ns*1.0e-3 << ",\"dur\":"
+              << (stop_ns - start_ns)*1.0e-3 << "},\n";
+        write_to_trace(ss);
+        flush_trace_if_necessary();
+    }
+}
+
 void trace_event_listener::on_async_event(async_thread_node &node,
     std::shared_ptr<profiler> &p) {
     if (!_terminate) {
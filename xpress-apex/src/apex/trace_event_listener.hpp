@@ -48,9 +48,16 @@ public:
   	void on_send(message_event_data &data) { APEX_UNUSED(data); };
   	void on_recv(message_event_data &data) { APEX_UNUSED(data); };
   	void set_node_id(int node_id, int node_count);
+    // the start and resume are written as one "complete" record at stop
+    listener_event_mask subscriptions(void) {
+        return listen_mask(listen_stop) | listen_mask(listen_yield) |
+            listen_mask(listen_sample_value);
+    }
   	void set_metadata(const char * name, const char * value);
     void on_async_event(async_thread_node &node, std::shared_ptr<profiler> &p);
     void on_async_metric(async_thread_node &node, std::shared_ptr<profiler> &p);
+    void on_kokkos_instance_event(kokkos_thread_node &node,
+        const std::string &name, uint64_t start_ns, uint64_t stop_ns);
     void end_trace_time(void);
 
 private:
@@ -61,6 +68,7 @@ private:
     void flush_trace_if_necessary(void);
   	void _common_stop(std::shared_ptr<profiler> &p);
     std::string make_tid (async_thread_node &node);
+    std::string make_tid (kokkos_thread_node &node);
     int get_thread_id_metadata();
   	static bool _initialized;
     size_t get_thread_index(void);
@@ -74,7 +82,11 @@ private:
     std::map<size_t, std::mutex*> mutexes;
     std::map<size_t, std::stringstream*> streams;
     std::mutex _vthread_mutex;
+    std::mutex _kokkos_vthread_mutex;
     std::map<async_thread_node, size_t> vthread_map;
+    std::map<kokkos_thread_node, size_t> kokkos_vthread_map;
+    // shared by both maps, which have their own locks
+    std::atomic<size_t> _next_vthread;
     double _end_time;
 };
 
@@ -0,0 +1,63 @@
+/*
+ * Measure the cost of each APEX_CLOCK timestamp source: the cost of one
+ * profiler::now_ns() call, and of one timer start/stop pair.  It also checks
+ * that consecutive timestamps never go backwards.  The clocks are switched
+ * with apex_clock::calibrate() between phases, so the APEX MAIN timer in the
+ * final profile spans several clocks and should be ignored.
+ */
+
+#include <stdio.h>
+#include <apex_api.hpp>
+#include <apex_clock.hpp>
+#include <chrono>
+#include <iostream>
+
+#define NOW_ITERATIONS 10000000
+#define TIMER_ITERATIONS 1000000
+
+double elapsed_ns(std::chrono::steady_clock::time_point start) {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+int main (int argc, char** argv) {
+    APEX_UNUSED(argc);
+    APEX_UNUSED(argv);
+    apex::init("apex clock overhead test", 0, 1);
+    apex::task_identifier * id = APEX_STATIC_TASK_ID("clock overhead");
+    const char * clocks[] = {"system", "steady", "tsc"};
+    bool monotonic = true;
+    printf("%8s %12s %16s %12s\n", "clock", "ns/now_ns", "ns/start+stop",
+        "backwards");
+    for (const char * clock : clocks) {
+        apex::apex_clock::calibrate(clock);
+        // time the timestamp itself
+        uint64_t backwards = 0;
+        uint64_t last = apex::profiler::now_ns();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0 ; i < NOW_ITERATIONS ; i++) {
+            uint64_t now = apex::profiler::now_ns();
+            if (now < last) { backwards++; }
+            last = now;
+        }
+        double per_now = elapsed_ns(start) / NOW_ITERATIONS;
+        // time a whole timer, which takes (at least) two timestamps
+        start = std::chrono::steady_clock::now();
+        for (int i = 0 ; i < TIMER_ITERATIONS ; i++) {
+            apex::stop(apex::start(id));
+        }
+        double per_timer = elapsed_ns(start) / TIMER_ITERATIONS;
+        printf("%8s %12.2f %16.2f %12lu\n", apex::apex_clock::name(),
+            per_now, per_timer, (unsigned long)backwards);
+        // the system clock is allowed to step, the others are not
+        if (std::string(clock).compare("system") != 0 && backwards > 0) {
+            monotonic = false;
+        }
+    }
+    apex::finalize();
+    apex::cleanup();
+    if (monotonic) {
+        std::cout << "Test passed." << std::endl;
+    }
+    return 0;
+}
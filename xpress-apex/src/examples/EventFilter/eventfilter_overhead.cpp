@@ -0,0 +1,60 @@
+/*
+ * Compare the cost of a timer start/stop with and without an event filter.
+ * Run it with APEX_EVENT_FILTER_FILE pointing at event_filter.json.  The
+ * filter is switched off and on through event_filter::have_filter, so both
+ * cases run in the same process.  Once a name has been checked, the
+ * decision is cached on its task_identifier, so the filtered case should
+ * cost about the same as the unfiltered one.
+ */
+
+#include <stdio.h>
+#include <apex_api.hpp>
+#include <event_filter.hpp>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#define ITERATIONS 1000000
+
+/* start/stop pairs by name, in ns per pair */
+double time_timers(const std::string& name) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0 ; i < ITERATIONS ; i++) {
+        apex::stop(apex::start(name));
+    }
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count() / ITERATIONS;
+}
+
+int main (int argc, char** argv) {
+    APEX_UNUSED(argc);
+    APEX_UNUSED(argv);
+    apex::init("apex event filter overhead test", 0, 1);
+    apex::event_filter& filter = apex::event_filter::instance();
+    if (!filter.have_filter) {
+        std::cerr << "Set APEX_EVENT_FILTER_FILE to event_filter.json"
+                  << std::endl;
+        apex::finalize();
+        apex::cleanup();
+        return 1;
+    }
+    // included by "task.*", so it is measured in both cases
+    static const std::string name("task_overhead");
+    time_timers(name); // warm up
+    filter.have_filter = false;
+    double unfiltered = time_timers(name);
+    filter.have_filter = true;
+    double filtered = time_timers(name);
+    // excluded by "scoped.*", so these never get timed
+    apex::profiler * p = apex::start("scoped_overhead");
+    bool excluded = (p == apex::profiler::get_disabled_profiler());
+    printf("ns per timer without filter: %8.2f\n", unfiltered);
+    printf("ns per timer with filter   : %8.2f\n", filtered);
+    apex::finalize();
+    apex::cleanup();
+    // allow for noise, the regex matching alone is many times slower
+    if (excluded && filtered < unfiltered * 1.25 + 50.0) {
+        std::cout << "Test passed." << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * Count the heap allocations made by APEX in steady state timer start/stop.
+ * Every operator new in the process is counted, so after a warm-up phase
+ * (to create the timers, profiles, queues and pools) any allocation during
+ * the measured phase comes from the per-timer path.  The test runs with
+ * the memory wrapper preloaded, as "apex_exec --apex:memory" would, so
+ * the wrapper's own bookkeeping is checked too.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <apex_api.hpp>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define NUM_THREADS 4
+#define WARMUP_ITERATIONS 100000
+#define ITERATIONS 1000000
+
+std::atomic<bool> counting(false);
+std::atomic<uint64_t> allocations(0);
+
+void * operator new(size_t size) {
+    if (counting) { allocations++; }
+    void * ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) { throw std::bad_alloc(); }
+    return ptr;
+}
+
+void operator delete(void * ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void * ptr, size_t) noexcept {
+    free(ptr);
+}
+
+std::atomic<int> ready(0);
+std::atomic<bool> go(false);
+std::atomic<int> warm(0);
+
+void timers(int iterations, apex::task_identifier * id) {
+    // construct the name once, so the string isn't counted
+    static const std::string name("timer_allocations by name");
+    for (int i = 0 ; i < iterations ; i++) {
+        apex::profiler * p = apex::start(id);
+        apex::stop(p);
+        apex::profiler * q = apex::start(name);
+        apex::stop(q);
+    }
+}
+
+void worker(void) {
+    apex::register_thread("worker");
+    apex::task_identifier * id =
+        apex::task_identifier::get_task_id("timer_allocations by id");
+    timers(WARMUP_ITERATIONS, id);
+    warm++;
+    while (!go) { }
+    timers(ITERATIONS, id);
+    apex::exit_thread();
+}
+
+int main (int argc, char** argv) {
+    APEX_UNUSED(argc);
+    APEX_UNUSED(argv);
+    apex::init("apex timer allocation benchmark", 0, 1);
+    std::vector<std::thread> threads;
+    for (int i = 0 ; i < NUM_THREADS ; i++) {
+        threads.push_back(std::thread(worker));
+    }
+    while (warm < NUM_THREADS) { }
+    counting = true;
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+    for (auto& t : threads) { t.join(); }
+    auto end = std::chrono::steady_clock::now();
+    counting = false;
+    uint64_t total_timers = (uint64_t)(NUM_THREADS) * ITERATIONS * 2;
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double per_timer = (double)(allocations) / (double)(total_timers);
+    std::cout << "Timers started and stopped: " << total_timers << std::endl;
+    std::cout << "Heap allocations: " << allocations << std::endl;
+    std::cout << "Allocations per timer: " << per_timer << std::endl;
+    std::cout << "Nanoseconds per timer: "
+              << (seconds * 1.0e9 * NUM_THREADS) / total_timers << std::endl;
+    apex::finalize();
+    apex::cleanup();
+    // allow for occasional growth of the profiler queues
+    if (per_timer < 0.001) {
+        std::cout << "Test passed." << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "apex_api.hpp"
+#include "apex_kokkos.hpp"
+#include <cstdint>
+#include <iostream>
+
+using namespace apex;
+using namespace std;
+
+/* Run with APEX_KOKKOS_SAMPLING=1 and APEX_KOKKOS_CALLPATH=1: a kernel
+ * sampled inside a region keeps its region in the timer name, and its
+ * launches are extrapolated separately from the same kernel outside of
+ * any region. */
+
+extern "C" {
+void kokkosp_init_library(int, uint64_t, uint32_t, KokkosPDeviceInfo*);
+void kokkosp_finalize_library(void);
+void kokkosp_begin_parallel_for(const char*, uint32_t, uint64_t*);
+void kokkosp_end_parallel_for(uint64_t);
+void kokkosp_push_profile_region(const char*);
+void kokkosp_pop_profile_region(void);
+}
+
+#define NUM_LAUNCHES 1000
+
+int main (int argc, char** argv) {
+  APEX_UNUSED(argc);
+  APEX_UNUSED(argv);
+  kokkosp_init_library(0, 0, 0, nullptr);
+  for(int i = 0; i < NUM_LAUNCHES; ++i) {
+    uint64_t kernid;
+    kokkosp_push_profile_region("region");
+    kokkosp_begin_parallel_for("kernel", 0, &kernid);
+    kokkosp_end_parallel_for(kernid);
+    kokkosp_pop_profile_region();
+    kokkosp_begin_parallel_for("kernel", 0, &kernid);
+    kokkosp_end_parallel_for(kernid);
+  }
+  kokkosp_finalize_library();
+  apex_profile * timer =
+      get_profile("Kokkos for, Dev: 0, kernel, Region: region");
+  apex_profile * inside =
+      get_profile("Kokkos for, Dev: 0, kernel, Region: region: Launches");
+  apex_profile * outside =
+      get_profile("Kokkos for, Dev: 0, kernel: Launches");
+  bool passed = (timer != nullptr && timer->calls > 0 &&
+      timer->calls < NUM_LAUNCHES &&
+      inside != nullptr && inside->accumulated == NUM_LAUNCHES &&
+      outside != nullptr && outside->accumulated == NUM_LAUNCHES);
+  cleanup();
+  if (passed) {
+    std::cout << "Test passed." << std::endl;
+    return 0;
+  }
+  std::cout << "Test failed." << std::endl;
+  return 1;
+}
@@ -0,0 +1,36 @@
+#include "apex_api.hpp"
+#include <unistd.h>
+
+using namespace apex;
+using namespace std;
+
+
+int main (int argc, char** argv) {
+  APEX_UNUSED(argc);
+  APEX_UNUSED(argv);
+  init("apex::start(task_identifier) unit test", 0, 1);
+  profiler * main_profiler = start(__func__);
+  // Resolve the identifier once, and reuse it for every start
+  task_identifier * id = task_identifier::get_task_id("foo");
+  for(int i = 0; i < 30; ++i) {
+    profiler * p = start(id);
+    stop(p);
+  }
+  // Mixing name based and identifier based starts is the same timer
+  for(int i = 0; i < 10; ++i) {
+    profiler * p = start("foo");
+    stop(p);
+  }
+  stop(main_profiler);
+  finalize();
+  apex_profile * profile = get_profile("foo");
+  if (profile) {
+    std::cout << "Value Reported : " << profile->calls << std::endl;
+    if (profile->calls == 40) {
+        std::cout << "Test passed." << std::endl;
+    }
+  }
+  cleanup();
+  return 0;
+}
+
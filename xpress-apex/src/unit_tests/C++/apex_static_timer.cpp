@@ -0,0 +1,37 @@
+#include "apex_api.hpp"
+#include <unistd.h>
+
+using namespace apex;
+using namespace std;
+
+void foo(void) {
+  // resolved the first time through, just a pointer after that
+  APEX_STATIC_SCOPED_TIMER("foo");
+}
+
+int main (int argc, char** argv) {
+  APEX_UNUSED(argc);
+  APEX_UNUSED(argv);
+  init("APEX_STATIC_SCOPED_TIMER unit test", 0, 1);
+  profiler * main_profiler = start(__func__);
+  for(int i = 0; i < 30; ++i) {
+    foo();
+  }
+  // the same literal anywhere else is the same identifier and timer
+  for(int i = 0; i < 10; ++i) {
+    profiler * p = start(APEX_STATIC_TASK_ID("foo"));
+    stop(p);
+  }
+  stop(main_profiler);
+  finalize();
+  apex_profile * profile = get_profile("foo");
+  if (profile) {
+    std::cout << "Value Reported : " << profile->calls << std::endl;
+    if (profile->calls == 40) {
+        std::cout << "Test passed." << std::endl;
+    }
+  }
+  cleanup();
+  return 0;
+}
+
@@ -0,0 +1,55 @@
+#include "apex_api.hpp"
+#include <thread>
+#include <vector>
+
+using namespace apex;
+using namespace std;
+
+/* Run with APEX_THREAD_LOCAL_PROFILES=1: every thread keeps its own
+ * profiles, which are merged when they are read. */
+
+#define NUM_THREADS 4
+#define NUM_CALLS 1000
+
+void worker(void) {
+  register_thread("worker");
+  for(int i = 0; i < NUM_CALLS; ++i) {
+    profiler * p = start("foo");
+    stop(p);
+  }
+  sample_value("bar", 1.0);
+  exit_thread();
+}
+
+int main (int argc, char** argv) {
+  APEX_UNUSED(argc);
+  APEX_UNUSED(argv);
+  init("APEX_THREAD_LOCAL_PROFILES unit test", 0, 1);
+  profiler * main_profiler = start(__func__);
+  std::vector<std::thread> threads;
+  for(int i = 0; i < NUM_THREADS; ++i) {
+    threads.push_back(std::thread(worker));
+  }
+  for(auto& t : threads) {
+    t.join();
+  }
+  // every thread's calls should be counted, and none are in flight
+  apex_profile * profile = get_profile("foo");
+  apex_profile * counter = get_profile("bar");
+  bool passed = (profile != nullptr && counter != nullptr &&
+      profile->calls == NUM_THREADS * NUM_CALLS &&
+      counter->calls == NUM_THREADS);
+  // a reset also clears the values not merged yet
+  std::thread t(worker);
+  t.join();
+  reset("foo");
+  profile = get_profile("foo");
+  passed = passed && (profile != nullptr && profile->calls == 0);
+  stop(main_profiler);
+  finalize();
+  if (passed) {
+    std::cout << "Test passed." << std::endl;
+  }
+  cleanup();
+  return 0;
+}
@@ -0,0 +1,46 @@
+#include "apex_api.hpp"
+#include <thread>
+#include <vector>
+
+using namespace apex;
+using namespace std;
+
+/* Run with APEX_THROTTLE_OVERHEAD=10 and APEX_THROTTLE_SAMPLE_PERIOD=10:
+ * an empty timer costs APEX far more than 10% of its duration, so it
+ * should be throttled, and then only one call in ten is timed. */
+
+#define NUM_THREADS 4
+#define NUM_CALLS 10000
+
+void worker(void) {
+  register_thread("worker");
+  for(int i = 0; i < NUM_CALLS; ++i) {
+    profiler * p = start("foo");
+    stop(p);
+  }
+  exit_thread();
+}
+
+int main (int argc, char** argv) {
+  APEX_UNUSED(argc);
+  APEX_UNUSED(argv);
+  init("APEX_THROTTLE_OVERHEAD unit test", 0, 1);
+  profiler * main_profiler = start(__func__);
+  std::vector<std::thread> threads;
+  for(int i = 0; i < NUM_THREADS; ++i) {
+    threads.push_back(std::thread(worker));
+  }
+  for(auto& t : threads) {
+    t.join();
+  }
+  stop(main_profiler);
+  finalize();
+  // after the first thousand or so on each thread, one call in ten
+  apex_profile * profile = get_profile("foo");
+  if (profile != nullptr && profile->calls > 0 &&
+      profile->calls < NUM_THREADS * NUM_CALLS / 2) {
+    std::cout << "Test passed." << std::endl;
+  }
+  cleanup();
+  return 0;
+}
@@ -0,0 +1,35 @@
+#include "apex.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include <unistd.h>
+
+int main (int argc, char** argv) {
+  apex_init("apex_get_percentile unit test", 0, 1);
+  apex_set_use_screen_output(1);
+  printf("APEX Version : %s\n", apex_version());
+  apex_profiler_handle main_profiler = apex_start(APEX_FUNCTION_ADDRESS,(void*)(main));
+  int i = 0;
+  // Call "Test Timer" 90 times for 0.1 ms, then 10 times for 10 ms
+  for(i = 0; i < 90; ++i) {
+    apex_profiler_handle p = apex_start(APEX_NAME_STRING,"Test Timer");
+    usleep(100);
+    apex_stop(p);
+  }
+  for(i = 0; i < 10; ++i) {
+    apex_profiler_handle p = apex_start(APEX_NAME_STRING,"Test Timer");
+    usleep(10000);
+    apex_stop(p);
+  }
+  apex_stop(main_profiler);
+  apex_finalize();
+  // Needs APEX_TIMER_HISTOGRAMS=1
+  double p50 = apex_get_percentile(APEX_NAME_STRING,"Test Timer", 50.0);
+  double p99 = apex_get_percentile(APEX_NAME_STRING,"Test Timer", 99.0);
+  printf("p50 : %f ns, p99 : %f ns\n", p50, p99);
+  // the median is one of the short calls, the 99th one of the long calls
+  if (p50 >= 1.0e5 && p50 < 1.0e7 && p99 >= 1.0e7) {
+      printf("Test passed.\n");
+  }
+  apex_cleanup();
+  return 0;
+}